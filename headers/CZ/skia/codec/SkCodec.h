@@ -1095,7 +1095,7 @@ private:
     friend class PNGCodecGM;    // for fillIncompleteImage
     friend class SkSampledCodec;
     friend class SkIcoCodec;
-    friend class SkPngCodec;     // for onGetGainmapCodec
+    friend class SkPngCodec;     // for onGetGainmapCodec and decodeBands
     friend class SkAndroidCodec;  // for handleFrameIndex
     friend class SkCodecPriv;     // for fEncodedInfo
 };
@@ -12,6 +12,7 @@
 #include "CZ/skia/private/base/SkAPI.h"
 
 class SkData;
+class SkPixmap;
 class SkStream;
 
 #include <memory>
@@ -35,6 +36,44 @@ SK_API std::unique_ptr<SkCodec> Decode(sk_sp<SkData>,
                                        SkCodec::Result*,
                                        SkCodecs::DecodeContext = nullptr);
 
+/**
+ *  Receives the output of DecodeBands() one band of rows at a time.
+ */
+class SK_API BandSink {
+public:
+    virtual ~BandSink() = default;
+
+    /**
+     *  Called with rows [top, top + band.height()) of the decoded image, in top-down order.
+     *  The pixels are only valid for the duration of the call.
+     *
+     *  Return false to stop decoding. DecodeBands() then returns kSuccess without
+     *  decoding the remaining rows.
+     */
+    virtual bool onBand(int top, const SkPixmap& band) = 0;
+};
+
+/**
+ *  Decodes the image held by |codec|, which must have been created by this decoder, into the
+ *  format described by |dstInfo|, handing the result to |sink| in bands of at most
+ *  |bandHeight| rows. Only a single band is ever allocated, so peak memory is proportional to
+ *  dstInfo.width() * bandHeight rather than to the size of the image.
+ *
+ *  Non-interlaced images are decoded in a single pass over the input. Rows of an Adam7
+ *  interlaced image are not complete until the last pass, so the input is re-read once per
+ *  band, which requires a rewindable stream; a taller band means fewer passes.
+ *
+ *  |dstInfo| must have the dimensions of the image. Subsets are not supported.
+ *
+ *  If the input is truncated, the rows that could be decoded are handed to |sink| and
+ *  kIncompleteInput (or kErrorInInput) is returned.
+ */
+SK_API SkCodec::Result DecodeBands(SkCodec* codec,
+                                   const SkImageInfo& dstInfo,
+                                   int bandHeight,
+                                   BandSink* sink,
+                                   const SkCodec::Options* options = nullptr);
+
 inline constexpr SkCodecs::Decoder Decoder() {
     return { "png", IsPng, Decode };
 }
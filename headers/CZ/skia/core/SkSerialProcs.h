@@ -92,6 +92,10 @@ struct SK_API SkSerialProcs {
 
     SkSerialTypefaceProc fTypefaceProc = nullptr;
     void*                fTypefaceCtx = nullptr;
+
+    // When serializing a picture to a stream or data, deflate it. The result is usually much
+    // smaller, but can only be read by a version of Skia that knows about compressed pictures.
+    bool                 fCompressPictures = false;
 };
 
 struct SK_API SkDeserialProcs {
@@ -8,6 +8,7 @@
 #include "CZ/skia/core/SkFontMgr.h"
 #include "CZ/skia/core/SkRefCnt.h"
 #include "CZ/skia/core/SkSpan.h"
+#include "CZ/skia/private/base/SkMutex.h"
 #include "CZ/skia/modules/skparagraph/include/FontArguments.h"
 #include "CZ/skia/modules/skparagraph/include/ParagraphCache.h"
 #include "CZ/skia/modules/skparagraph/include/TextStyle.h"
@@ -71,7 +72,10 @@ private:
     };
 
     bool fEnableFontFallback;
-    skia_private::THashMap<FamilyKey, std::vector<sk_sp<SkTypeface>>, FamilyKey::Hasher> fTypefaces;
+    // Paragraphs can be laid out on several threads at once
+    SkMutex fTypefacesMutex;
+    skia_private::THashMap<FamilyKey, std::vector<sk_sp<SkTypeface>>, FamilyKey::Hasher> fTypefaces
+            SK_GUARDED_BY(fTypefacesMutex);
     sk_sp<SkFontMgr> fDefaultFontManager;
     sk_sp<SkFontMgr> fAssetFontManager;
     sk_sp<SkFontMgr> fDynamicFontManager;
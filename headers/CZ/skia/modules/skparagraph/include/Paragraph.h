@@ -3,6 +3,7 @@
 #define Paragraph_DEFINED
 
 #include "CZ/skia/core/SkPath.h"
+#include "CZ/skia/core/SkSpan.h"
 #include "CZ/skia/modules/skparagraph/include/FontCollection.h"
 #include "CZ/skia/modules/skparagraph/include/Metrics.h"
 #include "CZ/skia/modules/skparagraph/include/ParagraphStyle.h"
@@ -10,6 +11,7 @@
 #include <unordered_set>
 
 class SkCanvas;
+class SkExecutor;
 
 namespace skia {
 namespace textlayout {
@@ -41,6 +43,13 @@ public:
 
     virtual void layout(SkScalar width) = 0;
 
+    // Lays out each of the paragraphs to the width, as layout() does, spreading them across the
+    // threads of executor. Returns when all of them are laid out. The paragraphs must be distinct
+    // and may share a FontCollection; the results are the same as laying them out one by one.
+    static void LayoutAll(SkSpan<Paragraph* const> paragraphs,
+                          SkScalar width,
+                          SkExecutor& executor);
+
     virtual void paint(SkCanvas* canvas, SkScalar x, SkScalar y) = 0;
 
     virtual void paint(ParagraphPainter* painter, SkScalar x, SkScalar y) = 0;
@@ -80,6 +89,14 @@ public:
     virtual void updateForegroundPaint(size_t from, size_t to, SkPaint paint) = 0;
     virtual void updateBackgroundPaint(size_t from, size_t to, SkPaint paint) = 0;
 
+    // Experimental API for editors that build a new paragraph for every edit of the text:
+    // call it with the paragraph this one replaces before the first layout, and only the
+    // words around the edit are shaped again; the rest reuses the shaping of previous.
+    // Everything is shaped as usual if the edit changes the styles or the placeholders, or
+    // cannot be confined to a single run of left-to-right text.
+    // previous must have been laid out, and can be deleted right after the call.
+    virtual void reuseShapingFrom(const Paragraph& previous) {}
+
     enum VisitorFlags {
         kWhiteSpace_VisitorFlag = 1 << 0,
     };
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef VirtualParagraph_DEFINED
+#define VirtualParagraph_DEFINED
+
+#include "CZ/skia/core/SkRect.h"
+#include "CZ/skia/core/SkRefCnt.h"
+#include "CZ/skia/core/SkScalar.h"
+#include "CZ/skia/core/SkString.h"
+#include "CZ/skia/modules/skparagraph/include/DartTypes.h"
+#include "CZ/skia/modules/skparagraph/include/FontCollection.h"
+#include "CZ/skia/modules/skparagraph/include/ParagraphStyle.h"
+#include "CZ/skia/modules/skunicode/include/SkUnicode.h"
+
+#include <memory>
+#include <vector>
+
+class SkCanvas;
+
+namespace skia {
+namespace textlayout {
+
+class Paragraph;
+class ParagraphBuilder;
+
+// Lays out a long text (a log, a chat transcript) only where it is looked at.
+//
+// The text is split into pieces at its hard line breaks, and each piece is a Paragraph of its
+// own that is shaped and broken into lines the first time it is painted or measured. Until then
+// its height is estimated from the pieces laid out so far, so getHeight() is exact only once
+// every piece has been laid out. Pieces far from the last painted area are released, keeping
+// their measured height.
+//
+// The whole text uses the default text style of the paragraph style. Text indexes are UTF-8
+// offsets into the whole text. Max lines and ellipsis apply to each piece separately.
+//
+// A line longer than kMaxPieceBytes is split into several pieces, after its last space within
+// the limit or else between two characters, and each such split shows as a line break that the
+// text does not have.
+class VirtualParagraph {
+public:
+    VirtualParagraph(SkString text,
+                     ParagraphStyle style,
+                     sk_sp<FontCollection> fonts,
+                     sk_sp<SkUnicode> unicode);
+    ~VirtualParagraph();
+
+    // Sets the width; pieces are laid out lazily, when they are needed
+    void layout(SkScalar width);
+
+    SkScalar getHeight() const { return fHeight; }
+    SkScalar getMaxWidth() const { return fWidth; }
+    bool isHeightEstimated() const { return fEstimatedPieces > 0; }
+
+    // Lays out the pieces that cover the area between top and bottom and the margin around it.
+    // Heights of the pieces above the area can change, so the area itself can move; returns the
+    // distance it moved down, which a scrolling view should add to its scroll position.
+    SkScalar layoutArea(SkScalar top, SkScalar bottom);
+
+    // Paints the pieces within the local clip bounds of the canvas, laying them out if needed
+    void paint(SkCanvas* canvas, SkScalar x, SkScalar y);
+
+    std::vector<TextBox> getRectsForRange(size_t start,
+                                          size_t end,
+                                          RectHeightStyle rectHeightStyle,
+                                          RectWidthStyle rectWidthStyle);
+    PositionWithAffinity getGlyphPositionAtCoordinate(SkScalar dx, SkScalar dy);
+
+    // The area laid out beyond the viewport, above and below it
+    static constexpr SkScalar kMargin = 1024;
+    // Longer pieces are split at a space (or anywhere) regardless of line breaks
+    static constexpr size_t kMaxPieceBytes = 64 * 1024;
+    // Laid out pieces beyond this count are released, the farthest from the viewport first
+    static constexpr int kMaxLaidOutPieces = 256;
+
+private:
+    struct Piece {
+        size_t fStart;  // UTF-8 range in fText
+        size_t fEnd;
+        SkScalar fTop;
+        SkScalar fHeight;
+        bool fMeasured;  // fHeight is not an estimate
+        std::unique_ptr<Paragraph> fParagraph;
+    };
+
+    void splitIntoPieces();
+    Paragraph* layoutPiece(size_t index);
+    SkScalar estimatedHeight(const Piece& piece) const;
+    void updateTops();
+    size_t pieceAt(SkScalar y) const;
+    size_t pieceContaining(size_t textIndex) const;
+    void releaseDistantPieces(size_t first, size_t last);
+
+    const SkString fText;
+    const ParagraphStyle fStyle;
+    const sk_sp<FontCollection> fFontCollection;
+    const sk_sp<SkUnicode> fUnicode;
+    std::unique_ptr<ParagraphBuilder> fBuilder;
+
+    std::vector<Piece> fPieces;
+    int fLaidOutPieces;
+    size_t fEstimatedPieces;
+    SkScalar fWidth;
+    SkScalar fHeight;
+
+    // What the pieces measured so far tell about the rest
+    size_t fMeasuredBytes;
+    SkScalar fMeasuredWidth;   // sum of the widths of the pieces laid out on one line
+    size_t fMeasuredLines;
+    SkScalar fMeasuredHeight;
+};
+}  // namespace textlayout
+}  // namespace skia
+
+#endif  // VirtualParagraph_DEFINED
@@ -33,6 +33,18 @@ SKSHAPER_API std::unique_ptr<SkShaper::ScriptRunIterator> ScriptRunIterator(cons
                                                                             size_t utf8Bytes,
                                                                             SkFourByteTag script);
 
+/** The HarfBuzz fonts made for typefaces are cached across all shapers. SetFaceCacheLimit sets
+ *  the number of typefaces they are kept for and returns the previous limit.
+ */
+SKSHAPER_API int GetFaceCacheLimit();
+SKSHAPER_API int SetFaceCacheLimit(int count);
+
+struct FaceCacheStats {
+    size_t fHits;
+    size_t fMisses;
+};
+SKSHAPER_API FaceCacheStats GetFaceCacheStats();
+
 SKSHAPER_API void PurgeCaches();
 }  // namespace SkShapers::HB
 
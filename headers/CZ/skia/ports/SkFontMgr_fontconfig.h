@@ -24,4 +24,23 @@ SK_API sk_sp<SkFontMgr> SkFontMgr_New_FontConfig(FcConfig* fc, std::unique_ptr<S
 #if !defined(SK_DISABLE_LEGACY_FONTCONFIG_FACTORY)
 SK_API sk_sp<SkFontMgr> SkFontMgr_New_FontConfig(FcConfig* fc);
 #endif
+
+/** Write the fonts a font manager made by SkFontMgr_New_FontConfig(fc, scanner) would find,
+ *  with their files, styles and the families the generic names resolve to, to a snapshot at
+ *  'path'. Takes ownership of 'fc' as SkFontMgr_New_FontConfig does.
+ *  Returns false if the snapshot could not be written.
+ */
+SK_API bool SkFontMgr_FontConfig_WriteSnapshot(FcConfig* fc,
+                                               std::unique_ptr<SkFontScanner> scanner,
+                                               const char path[]);
+
+/** Create a font manager from a snapshot written by SkFontMgr_FontConfig_WriteSnapshot,
+ *  without initializing or querying FontConfig.
+ *  Returns nullptr if the snapshot is missing or invalid, or if any FontConfig configuration
+ *  file or font directory has been modified since it was written.
+ *  Matching uses the snapshot's families and styles only; FontConfig substitutions other than
+ *  the generic family names, synthetic bold and oblique, and character set matching are not
+ *  available.
+ */
+SK_API sk_sp<SkFontMgr> SkFontMgr_New_FontConfigSnapshot(const char path[]);
 #endif // #ifndef SkFontMgr_fontconfig_DEFINED
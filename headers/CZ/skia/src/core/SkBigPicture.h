@@ -57,10 +57,11 @@ public:
     const SkBBoxHierarchy* bbh() const { return fBBH.get(); }
     const SkRecord*     record() const { return fRecord.get(); }
 
-private:
+    // The snapshots of the drawables that record() refers to, for replaying it elsewhere
     int drawableCount() const;
     SkPicture const* const* drawablePicts() const;
 
+private:
     const SkRect                         fCullRect;
     const size_t                         fApproxBytesUsedBySubPictures;
     sk_sp<const SkRecord>                fRecord;
@@ -91,6 +91,13 @@ public:
         return fMap.count();
     }
 
+    void setMaxCount(int maxCount) {
+        fMaxCount = maxCount;
+        while (fMap.count() > fMaxCount) {
+            this->remove(fLRU.tail()->fKey);
+        }
+    }
+
     template <typename Fn>  // f(K*, V*)
     void foreach(Fn&& fn) {
         typename SkTInternalLList<Entry>::Iter iter;
@@ -81,6 +81,8 @@ private:
     int fCount;
     Branch fRoot;
     std::vector<Node> fNodes;
+    // Scratch for insert(), kept to insert again without allocating.
+    std::vector<Branch> fBranches;
 };
 
 #endif
@@ -98,6 +98,10 @@ public:
     // May change count() and the indices of ops, but preserves their order.
     void defrag();
 
+    // Destroy all the commands, keeping the memory to record new ones: the command array keeps
+    // its size, and the next commands go into one block as big as the last ones needed.
+    void reset();
+
 private:
     // An SkRecord is structured as an array of pointers into a big chunk of memory where
     // records representing each canvas draw call are stored:
@@ -131,6 +135,8 @@ private:
 
     void grow();
 
+    static constexpr size_t kFirstHeapAllocation = 256;
+
     // A typed pointer to some bytes in fAlloc.  visit() and mutate() allow polymorphic dispatch.
     struct Record {
         SkRecords::Type fType;
@@ -177,9 +183,13 @@ private:
         fReserved{0};
     skia_private::AutoTMalloc<Record> fRecords;
 
+    // The block fAlloc starts in after reset(). It must outlive fAlloc.
+    skia_private::AutoTMalloc<char> fBlock;
+    size_t                          fBlockSize{0};
+
     // fAlloc needs to be a data structure which can append variable length data in contiguous
     // chunks, returning a stable handle to that data for later retrieval.
-    SkArenaAlloc fAlloc{256};
+    SkArenaAlloc fAlloc{kFirstHeapAllocation};
     size_t       fApproxBytesAllocated{0};
 };
 
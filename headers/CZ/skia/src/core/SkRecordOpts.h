@@ -8,11 +8,42 @@
 #ifndef SkRecordOpts_DEFINED
 #define SkRecordOpts_DEFINED
 
+#include <cstdint>
+
 class SkRecord;
 
+// The optimizations SkRecordOptimize can run, as bits of a mask.  They run in this order.
+enum SkRecordOptimization : uint32_t {
+    kNoopSaveRestores_SkRecordOptimization                = 1 << 0,
+    kNoopSaveLayerDrawRestores_SkRecordOptimization       = 1 << 1,
+    kMergeSvgOpacityAndFilterLayers_SkRecordOptimization  = 1 << 2,
+    kCollapseMatrices_SkRecordOptimization                = 1 << 3,
+    kNoopRedundantClips_SkRecordOptimization              = 1 << 4,
+    kNoopOccludedDraws_SkRecordOptimization               = 1 << 5,
+};
+static constexpr int kSkRecordOptimizationCount = 6;
+
+// What SkRecordOptimize runs by default.
+static constexpr uint32_t kDefault_SkRecordOptimizations =
+#ifndef SK_BUILD_FOR_ANDROID_FRAMEWORK
+        kNoopSaveLayerDrawRestores_SkRecordOptimization |
+#endif
+        kMergeSvgOpacityAndFilterLayers_SkRecordOptimization |
+        kCollapseMatrices_SkRecordOptimization |
+        kNoopRedundantClips_SkRecordOptimization;
+
+// What each optimization did, indexed by the bit number of the optimization.
+struct SkRecordOptimizeStats {
+    int fNoopedOps[kSkRecordOptimizationCount] = {};  // Ops it turned into NoOps.
+    double fNanos[kSkRecordOptimizationCount] = {};   // Time it took.
+};
+
 // Run all optimizations in recommended order.
 void SkRecordOptimize(SkRecord*);
 
+// Run the given mask of optimizations, and if stats isn't null, add up what each of them did.
+void SkRecordOptimize(SkRecord*, uint32_t optimizations, SkRecordOptimizeStats* stats = nullptr);
+
 // Turns logical no-op Save-[non-drawing command]*-Restore patterns into actual no-ops.
 void SkRecordNoopSaveRestores(SkRecord*);
 
@@ -26,4 +57,19 @@ void SkRecordNoopSaveLayerDrawRestores(SkRecord*);
 // the alpha of the first SaveLayer to the second SaveLayer.
 void SkRecordMergeSvgOpacityAndFilterLayers(SkRecord*);
 
+// Turns matrix changes overridden by a later SetMatrix or Restore into no-ops, and folds runs
+// of Translates or Scales into their last one.
+void SkRecordCollapseMatrices(SkRecord*);
+
+// Turns a ClipRect that cannot shrink the clip set by the previous ClipRect into a no-op, when
+// only draws come between them. Antialiased clips are kept, since on raster repeating one changes
+// the coverage of its edges.
+void SkRecordNoopRedundantClips(SkRecord*);
+
+// Turns draws into no-ops when an opaque DrawPaint later covers them under the same clip.
+// This is exact as long as the clip has no soft edges, so it bails out on antialiased clips in
+// the record, but it cannot tell if the picture is played back under an antialiased clip;
+// the edges of that clip may then differ slightly.  Not run by default.
+void SkRecordNoopOccludedDraws(SkRecord*);
+
 #endif//SkRecordOpts_DEFINED
@@ -57,6 +57,8 @@ public:
     bool prepareForDrawable(SkGlyph*) override SK_REQUIRES(fStrikeLock);
 
     bool mergeFromBuffer(SkReadBuffer& buffer) SK_EXCLUDES(fStrikeLock);
+    // Write the glyphs that have images, paths or drawables, in the form read by mergeFromBuffer.
+    void flattenGlyphs(SkWriteBuffer& buffer) SK_EXCLUDES(fStrikeLock);
     static void FlattenGlyphsByType(SkWriteBuffer& buffer,
                                     SkSpan<SkGlyph> images,
                                     SkSpan<SkGlyph> paths,
@@ -99,6 +101,11 @@ public:
     SkSpan<const SkGlyph*> prepareDrawables(
             SkSpan<const SkGlyphID> glyphIDs, const SkGlyph* results[]) SK_EXCLUDES(fStrikeLock);
 
+    // Decide the action for each glyph, and generate whatever that action will draw: the image
+    // for mask and SDFT actions, or the path or drawable.
+    void prerasterize(SkSpan<const SkPackedGlyphID> glyphIDs,
+                      skglyph::ActionType actionType) SK_EXCLUDES(fStrikeLock);
+
     // SkStrikeForGPU APIs
     const SkDescriptor& getDescriptor() const override {
         return fStrikeSpec.descriptor();
@@ -197,11 +204,12 @@ private:
 
     SkArenaAlloc            fAlloc SK_GUARDED_BY(fStrikeLock) {kMinAllocAmount};
 
-    // The following are protected by the SkStrikeCache's mutex.
+    // The following are protected by the mutex of this strike's SkStrikeCache shard.
     SkStrike*                       fNext{nullptr};
     SkStrike*                       fPrev{nullptr};
     std::unique_ptr<SkStrikePinner> fPinner;
     size_t                          fMemoryUsed{sizeof(SkStrike)};
+    uint64_t                        fLastUse{0};  // the cache's use clock when last found
     bool                            fRemoved{false};
 };
 
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkStrikeDiskCache_DEFINED
+#define SkStrikeDiskCache_DEFINED
+
+#include "CZ/skia/core/SkRefCnt.h"
+#include "CZ/skia/core/SkString.h"
+
+class SkData;
+class SkStrike;
+
+// Keeps the glyphs of strikes in files in a directory, so that a later process can merge them into
+// its strikes instead of generating them with the scaler context again.
+//
+// Each strike is one file, named by a hash of its key and mapped into memory when read. The key
+// identifies the font file by its 'head' table, glyph count, names and variation position (the
+// typeface ID in the descriptor differs between processes), followed by the rest of the strike's
+// descriptor. Files with a different format version, a different key, or a payload that does not
+// match its checksum are ignored, and their glyphs are generated as usual.
+//
+// Typefaces with color palettes are not stored, since the palette chosen by SkFontArguments is not
+// part of the key.
+//
+// It is reference counted so that SkStrikeCache can replace it while other threads still use it.
+class SkStrikeDiskCache : public SkRefCnt {
+public:
+    explicit SkStrikeDiskCache(const char directory[]);
+
+    // Merge the stored glyphs for strike into it. Returns false if nothing usable was stored.
+    bool load(SkStrike* strike) const;
+
+    // Store the glyphs strike holds now, replacing anything stored for it before.
+    // The file is written to a temporary name and then renamed, so readers never see a partial
+    // file.
+    bool store(SkStrike* strike) const;
+
+private:
+    // Returns the key for strike, or nullptr if strike should not be stored.
+    static sk_sp<SkData> MakeKey(const SkStrike& strike);
+
+    SkString pathFor(const SkData& key) const;
+
+    const SkString fDirectory;
+};
+
+#endif  // SkStrikeDiskCache_DEFINED
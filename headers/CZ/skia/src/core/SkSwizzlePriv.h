@@ -29,7 +29,17 @@ namespace SkOpts {
                            RGB_to_BGR1,     // i.e. swap RB and insert an opaque alpha
                            gray_to_RGB1,    // i.e. expand to color channels + an opaque alpha
                            grayA_to_RGBA,   // i.e. expand to color channels
-                           grayA_to_rgbA;   // i.e. expand to color channels and premultiply
+                           grayA_to_rgbA,   // i.e. expand to color channels and premultiply
+                           RGB16_to_RGB1,   // i.e. strip to 8 bits and insert an opaque alpha
+                           RGB16_to_BGR1,   // i.e. strip to 8 bits, swap RB and insert an alpha
+                           RGBA16_to_RGBA,  // i.e. strip to 8 bits
+                           RGBA16_to_BGRA,  // i.e. strip to 8 bits and swap RB
+                           RGBA16_to_rgbA,  // i.e. strip to 8 bits and premultiply
+                           RGBA16_to_bgrA;  // i.e. strip to 8 bits, swap RB and premultiply
+
+    // Look up 8-bit indices in a color table of 8888 pixels.
+    using Swizzle_8888_index = void (*)(uint32_t*, const uint8_t*, const uint32_t table[], int);
+    extern Swizzle_8888_index index_to_8888;
 
     void Init_Swizzler();
 }  // namespace SkOpts
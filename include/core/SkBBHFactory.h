@@ -24,7 +24,7 @@ public:
     };
 
     /**
-     * Insert N bounding boxes into the hierarchy.
+     * Insert N bounding boxes into the hierarchy, replacing any inserted before.
      */
     virtual void insert(const SkRect[], int N) = 0;
     virtual void insert(const SkRect[], const Metadata[], int N);
@@ -64,4 +64,14 @@ public:
     sk_sp<SkBBoxHierarchy> operator()() const override;
 };
 
+/**
+ *  Builds a packed Hilbert R-Tree, which is faster to search than SkRTree and uses less memory,
+ *  but is a little slower to build. Prefer it for pictures with very many ops that are played
+ *  back often, such as maps that are scrolled.
+ */
+class SK_API SkHilbertRTreeFactory : public SkBBHFactory {
+public:
+    sk_sp<SkBBoxHierarchy> operator()() const override;
+};
+
 #endif
@@ -69,6 +69,21 @@ public:
      */
     static int SetFontCacheCountLimit(int count);
 
+    /**
+     *  Keep the glyphs of the font cache in files in directory. Entries created
+     *  after this call first load any glyphs stored there for them, instead of
+     *  generating those glyphs again. Pass nullptr to stop using a directory.
+     *  Entries already in the cache are not reloaded, so call this before
+     *  drawing text to use the directory for every entry.
+     */
+    static void SetFontCacheDirectory(const char directory[]);
+
+    /**
+     *  Write the glyphs of every entry in the font cache to the directory given
+     *  to SetFontCacheDirectory(), and return the number of entries written.
+     */
+    static int WriteFontCacheToDirectory();
+
     /**
      *  Return the current limit to the number of entries in the typeface cache.
      *  A cache "entry" is associated with each typeface.
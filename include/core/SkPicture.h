@@ -11,6 +11,7 @@
 #include "include/core/SkRect.h"
 #include "include/core/SkRefCnt.h"
 #include "include/core/SkShader.h"  // IWYU pragma: keep
+#include "include/core/SkSize.h"
 #include "include/core/SkTypes.h"
 
 #include <atomic>
@@ -19,8 +20,11 @@
 
 class SkCanvas;
 class SkData;
+class SkExecutor;
 class SkMatrix;
+class SkPixmap;
 class SkStream;
+class SkSurfaceProps;
 class SkWStream;
 enum class SkFilterMode;
 struct SkDeserialProcs;
@@ -70,6 +74,10 @@ public:
         may be used to provide user context to procs->fPictureProc; procs->fPictureProc
         is called with a pointer to data, data byte length, and user context.
 
+        The ops and the flattened objects are read in place where they are 4-byte aligned in
+        data, and copied otherwise. Encoded images read in place keep a reference to data rather
+        than a copy, so data from SkData::MakeFromFileName() stays in the (shared) mapped pages.
+
         @param data   container for serial data
         @param procs  custom serial data decoders; may be nullptr
         @return       SkPicture constructed from data
@@ -135,6 +143,23 @@ public:
     */
     virtual void playback(SkCanvas* canvas, AbortCallback* callback = nullptr) const = 0;
 
+    /** Draws SkPicture into the pixels of dst, transformed by matrix, in parallel: dst is split
+        into tiles of tileSize, and each tile is drawn on one of the threads of executor by a
+        raster SkCanvas of its own, clipped to the tile. Returns when all tiles are drawn.
+
+        Each tile replays the commands that its bounding box hierarchy finds within the tile,
+        with the saves, restores and layers around them; SkPicture recorded without an
+        SkBBHFactory replays every command for every tile.
+
+        @param dst       pixels to draw into
+        @param matrix    transforms SkPicture into dst
+        @param tileSize  size of the tiles; dst is drawn in one piece if empty
+        @param executor  runs the tiles
+        @param props     properties of the tile canvases; may be nullptr
+    */
+    void playbackTiled(const SkPixmap& dst, const SkMatrix& matrix, SkISize tileSize,
+                       SkExecutor& executor, const SkSurfaceProps* props = nullptr) const;
+
     /** Returns cull SkRect for this picture, passed in when SkPicture was created.
         Returned SkRect does not specify clipping SkRect for SkPicture; cull is hint
         of SkPicture bounds.
@@ -166,6 +191,9 @@ public:
         clients want to, for example, encode these SkImages as PNGs so they can be
         deserialized, they must provide SkSerialProcs with the fImageProc set to do so.
 
+        If procs->fCompressPictures is set, the picture is deflated; MakeFromData() and
+        MakeFromStream() read it back.
+
         @param procs  custom serial data encoders; may be nullptr
         @return       storage containing serialized SkPicture
 
@@ -184,6 +212,9 @@ public:
         clients want to, for example, encode these SkImages as PNGs so they can be
         deserialized, they must provide SkSerialProcs with the fImageProc set to do so.
 
+        If procs->fCompressPictures is set, the picture is deflated; MakeFromData() and
+        MakeFromStream() read it back.
+
         @param stream  writable serial data stream
         @param procs   custom serial data encoders; may be nullptr
 
@@ -90,9 +90,27 @@ public:
      */
     sk_sp<SkDrawable> finishRecordingAsDrawable();
 
+    /**
+     *  Keep the memory of the last few pictures and drawables this recorder finished, and record
+     *  into it again once they are deleted instead of allocating more. When the same kind of
+     *  content is recorded every frame, the ops then stop allocating memory after a few frames.
+     *
+     *  The ops of a deleted picture, and the images and pictures they refer to, are only
+     *  released when the recorder records into its memory again, or when recycling is turned
+     *  off or the recorder is deleted.
+     *
+     *  To reuse the bounding box hierarchy as well, pass the same one to beginRecording() again
+     *  once the picture using it is deleted; SkRTree and SkHilbertRTree keep their memory when
+     *  they are filled again.
+     */
+    void setRecycling(bool recycling);
+
 private:
     void reset();
 
+    // The record to begin recording into.
+    sk_sp<SkRecord> makeRecord();
+
     /** Replay the current (partially recorded) operation stream into
         canvas. This call doesn't close the current recording.
     */
@@ -108,6 +126,12 @@ private:
     SkRect fCullRect;
     bool fActivelyRecording;
 
+    // Records handed out while recycling: enough for a frame recording while one is drawn and
+    // another is waiting to be.
+    static constexpr int kRecycledRecordCount = 3;
+    sk_sp<SkRecord> fRecycledRecords[kRecycledRecordCount];
+    bool fRecycling;
+
     SkPictureRecorder(SkPictureRecorder&&) = delete;
     SkPictureRecorder& operator=(SkPictureRecorder&&) = delete;
 };
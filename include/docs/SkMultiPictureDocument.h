@@ -11,11 +11,16 @@
 #include "include/core/SkPicture.h"
 #include "include/core/SkRefCnt.h"
 #include "include/core/SkSize.h"
+#include "include/core/SkSpan.h"
 #include "include/core/SkTypes.h"
 
 #include <functional>
+#include <vector>
 
+class SkData;
 class SkDocument;
+class SkExecutor;
+class SkImage;
 class SkStreamSeekable;
 class SkWStream;
 struct SkDeserialProcs;
@@ -34,6 +39,17 @@ namespace SkMultiPictureDocument {
 SK_API sk_sp<SkDocument> Make(SkWStream* dst, const SkSerialProcs* = nullptr,
                               std::function<void(const SkPicture*)> onEndPage = nullptr);
 
+/**
+ *  Like Make(), but writes each page as a picture of its own after a table of their offsets, so
+ *  that pages can be read in any order, and in parallel, with ReadPage(). Read() and
+ *  ReadPageCount() accept both formats.
+ *
+ *  Pages are serialized when they end, so resources shared between pages (typefaces, images)
+ *  are written once per page that uses them.
+ */
+SK_API sk_sp<SkDocument> MakeIndexed(SkWStream* dst, const SkSerialProcs* = nullptr,
+                                     std::function<void(const SkPicture*)> onEndPage = nullptr);
+
 /**
  *  Returns the number of pages in the SkMultiPictureDocument.
  */
@@ -48,6 +64,33 @@ SK_API bool Read(SkStreamSeekable* src,
                  SkDocumentPage* dstArray,
                  int dstArrayCount,
                  const SkDeserialProcs* = nullptr);
+
+/**
+ *  Returns the number of pages in a document written by MakeIndexed(), or 0 if data is not
+ *  one.
+ */
+SK_API int ReadIndexedPageCount(const SkData* data);
+
+/**
+ *  Reads page pageIndex of a document written by MakeIndexed(), without reading the others.
+ *  It may be called from several threads at once with the same data, as long as procs can be.
+ *  Returns a page without a picture on error.
+ */
+SK_API SkDocumentPage ReadPage(const SkData* data,
+                               int pageIndex,
+                               const SkDeserialProcs* = nullptr);
+
+/**
+ *  Reads the pages pageIndices of a document written by MakeIndexed() and draws each of them
+ *  into a raster image of its size times scale, spreading the pages across the threads of
+ *  executor. Returns the images in the order of pageIndices, once all of them are drawn; the
+ *  image of a page that could not be read is null.
+ */
+SK_API std::vector<sk_sp<SkImage>> RasterizePages(const SkData* data,
+                                                  SkSpan<const int> pageIndices,
+                                                  float scale,
+                                                  SkExecutor& executor,
+                                                  const SkDeserialProcs* = nullptr);
 }  // namespace SkMultiPictureDocument
 
 #endif  // SkMultiPictureDocument_DEFINED
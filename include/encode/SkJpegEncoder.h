@@ -10,6 +10,7 @@
 
 #include "include/codec/SkEncodedOrigin.h"
 #include "include/core/SkRefCnt.h"
+#include "include/core/SkSize.h"
 #include "include/private/base/SkAPI.h"
 
 #include <memory>
@@ -17,6 +18,7 @@
 
 class SkColorSpace;
 class SkData;
+class SkCodec;
 class SkEncoder;
 class SkPixmap;
 class SkWStream;
@@ -104,6 +106,25 @@ SK_API bool Encode(SkWStream* dst,
                    const SkColorSpace* srcColorSpace,
                    const Options& options);
 
+/**
+ *  Re-encode the image decoded by |src| as a JPEG of |dstDimensions| (in the same, unoriented,
+ *  space as |src|'s dimensions) to the |dst| stream.
+ *
+ *  If |src| can decode to 8-bit Y, U and V planes (see SkCodec::queryYUVAInfo), the image is
+ *  never converted to RGB: each plane is resampled on its own, keeping the source chroma
+ *  subsampling, and the planes are handed to the encoder as is. In that case
+ *  |options.fDownsample| is ignored. Otherwise the image is decoded to RGBA, using the
+ *  codec's native scaling when possible, then resampled and encoded.
+ *
+ *  Unless |options.fOrigin| is set, the origin of |src| is preserved.
+ *
+ *  Returns true on success.
+ */
+SK_API bool Transcode(SkWStream* dst,
+                      SkCodec* src,
+                      SkISize dstDimensions,
+                      const Options& options);
+
 /**
 *  Encode the provided image and return the resulting bytes. If the image was created as
 *  a texture-backed image on a GPU context, that |ctx| must be provided so the pixels
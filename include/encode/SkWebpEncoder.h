@@ -27,6 +27,18 @@ enum class Compression {
     kLossless,
 };
 
+/**
+ *  Trades encoding speed for encoded size. Higher effort never changes the decoded pixels
+ *  of a lossless encode, and only marginally affects the quality of a lossy one.
+ */
+enum class Effort {
+    kDefault,   // lossy: libwebp method 3, lossless: method 0 with |fQuality| as the effort.
+    kFastest,
+    kFast,
+    kBalanced,
+    kSmallest,
+};
+
 struct SK_API Options {
     /**
      *  |fCompression| determines whether we will use webp lossy or lossless compression.
@@ -43,6 +55,26 @@ struct SK_API Options {
     Compression fCompression = Compression::kLossy;
     float fQuality = 100.0f;
 
+    /**
+     *  |fEffort| selects libwebp's |method| (and, for kLossless, the effort level, overriding
+     *  |fQuality|). See WebPConfigLosslessPreset() for the lossless levels.
+     */
+    Effort fEffort = Effort::kDefault;
+
+    /**
+     *  If true, libwebp may use an additional thread for analysis and entropy coding
+     *  (|thread_level|). The output does not depend on this setting.
+     */
+    bool fMultithreaded = false;
+
+    /**
+     *  If positive, a soft budget in milliseconds for encoding the image (or each frame of an
+     *  animation). The effort implied by |fEffort| is lowered, based on the pixel count and a
+     *  model of libwebp's throughput, until the estimated encode time fits. When encoding an
+     *  animation, the model is corrected with the measured time of each frame.
+     */
+    float fTargetEncodeTimeMs = 0;
+
     /**
      * An optional ICC profile to override the default behavior.
      *
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPictureCacheCanvas_DEFINED
+#define SkPictureCacheCanvas_DEFINED
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkRefCnt.h"
+#include "include/core/SkSize.h"
+#include "include/core/SkTypes.h"
+#include "include/private/base/SkMutex.h"
+#include "include/private/base/SkThreadAnnotations.h"
+#include "include/utils/SkNWayCanvas.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class GrRecordingContext;
+class SkDrawable;
+class SkMatrix;
+class SkPaint;
+class SkPicture;
+class SkResourceCache;
+struct SkRect;
+
+/** \class SkPictureCacheCanvas
+
+    A proxy canvas that draws nested pictures and drawables from raster images it keeps in a
+    cache, as a compositor caches layers.  Content is cached the second time it is drawn under
+    the same matrix, up to an integer translation, and is drawn from the cache after that.
+
+    Images of a picture are purged when the picture is deleted; a drawable is looked up by its
+    generation ID, so it must call notifyDrawingChanged() when it changes.  The least recently
+    used images are purged to keep the cache within its byte budget.
+
+    Cached content is composited as if it was drawn into a layer, so content that blends with
+    what is below it in other ways than src-over can look different.  Content drawn under
+    perspective, or larger than the size of a tile, is never cached.
+*/
+class SK_API SkPictureCacheCanvas : public SkNWayCanvas {
+public:
+    /**
+     *  Holds the images; it can be shared by canvases, across threads, from frame to frame.
+     */
+    class SK_API Cache : public SkRefCnt {
+    public:
+        static sk_sp<Cache> Make(size_t byteBudget);
+        ~Cache() override;
+
+        size_t bytesUsed() const;
+        size_t byteBudget() const;
+        void purgeAll();
+
+    private:
+        explicit Cache(size_t byteBudget);
+
+        mutable SkMutex fMutex;
+        std::unique_ptr<SkResourceCache> fCache SK_GUARDED_BY(fMutex);
+
+        friend class SkPictureCacheCanvas;
+    };
+
+    /**
+     * The new SkPictureCacheCanvas forwards to the specified canvas.  Also copies the target
+     * canvas matrix and clip bounds.
+     */
+    SkPictureCacheCanvas(SkCanvas* canvas, sk_sp<Cache> cache);
+    ~SkPictureCacheCanvas() override;
+
+    // Forwarded to the wrapped canvas.
+    SkISize getBaseLayerSize() const override { return fTarget->getBaseLayerSize(); }
+    GrRecordingContext* recordingContext() const override { return fTarget->recordingContext(); }
+
+    // Larger content is drawn directly.
+    static constexpr int kMaxTileSize = 2048;
+
+protected:
+    void onDrawPicture(const SkPicture*, const SkMatrix*, const SkPaint*) override;
+    void onDrawDrawable(SkDrawable*, const SkMatrix*) override;
+
+private:
+    // Draws the content from the cache, rasterizing it with draw if it is drawn the second time.
+    // Returns false if it is not (yet) in the cache, and the content must be drawn directly.
+    bool drawCached(uint64_t sharedID,
+                    const SkRect& bounds,
+                    const SkMatrix* matrix,
+                    const SkPaint* paint,
+                    const std::function<void(SkCanvas*)>& draw);
+
+    SkCanvas* fTarget;
+    sk_sp<Cache> fCache;
+};
+
+#endif
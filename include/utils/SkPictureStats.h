@@ -0,0 +1,68 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPictureStats_DEFINED
+#define SkPictureStats_DEFINED
+
+#include "include/core/SkRect.h"
+#include "include/core/SkTypes.h"
+
+#include <cstddef>
+#include <vector>
+
+class SkJSONWriter;
+class SkPicture;
+
+/** \struct SkPictureStats
+
+    What the ops of a picture are, and roughly how much they cost to draw with the raster
+    backend, to find pictures that are too expensive before drawing them.
+
+    The cost of a draw is the number of pixels of its bounds (in picture space, clipped to the
+    cull rect) multiplied by a weight for the complexity of its paint: shaders, filters, blend
+    modes and images weigh more than a solid color. It is an estimate for comparing ops and
+    pictures with each other, not a prediction of time. Nested pictures cost what their own ops
+    cost, regardless of their matrix.
+*/
+struct SK_API SkPictureStats {
+    static constexpr int kDefaultHottestOpCount = 10;
+
+    /**
+     *  Analyzes the ops of picture, keeping the hottestOpCount costliest ones.
+     */
+    static SkPictureStats Make(const SkPicture* picture,
+                               int hottestOpCount = kDefaultHottestOpCount);
+
+    struct OpType {
+        const char* fName;
+        int         fCount;
+        double      fCost;
+    };
+
+    struct Op {
+        int         fIndex;   // in the picture's ops
+        const char* fName;
+        SkRect      fBounds;
+        double      fCost;
+    };
+
+    int    fOpCount = 0;
+    size_t fBytesUsed = 0;  // SkPicture::approximateBytesUsed()
+    double fCost = 0;
+
+    std::vector<OpType> fOpTypes;  // the types of ops in the picture
+
+    int    fSaveLayerCount = 0;
+    int    fMaxSaveLayerDepth = 0;
+    size_t fPeakSaveLayerBytes = 0;  // the most memory the layers open at once take, as N32
+
+    std::vector<Op> fHottestOps;  // costliest first
+
+    void dumpJSON(SkJSONWriter*) const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPictureStream_DEFINED
+#define SkPictureStream_DEFINED
+
+#include "include/core/SkTypes.h"
+
+class SkCanvas;
+class SkPicture;
+class SkStream;
+class SkWStream;
+struct SkDeserialProcs;
+struct SkRect;
+struct SkSerialProcs;
+
+/** \class SkPictureStream
+
+    A serialized form of SkPicture that can be drawn while it is read, without ever holding the
+    whole picture in memory.
+
+    The picture is written as a sequence of small pictures (chunks) of about opsPerChunk ops
+    each, which draw the original when drawn one after the other. Each chunk is serialized as
+    with SkPicture::serialize(), except for the images, which are written once, before the first
+    chunk that uses them, with the number of times they are used. Play() decodes one chunk at a
+    time, draws it and frees it, and drops each image after its last use.
+
+    Chunks only end between ops that are not inside a saveLayer(); ops inside a layer, and
+    nested pictures, stay in one chunk.
+*/
+class SK_API SkPictureStream {
+public:
+    static constexpr int kDefaultOpsPerChunk = 4096;
+
+    /**
+     *  Writes picture to stream. procs are used as by SkPicture::serialize(); they may be
+     *  nullptr. Returns false if the stream could not be written.
+     */
+    static bool Write(const SkPicture* picture, SkWStream* stream,
+                      const SkSerialProcs* procs = nullptr,
+                      int opsPerChunk = kDefaultOpsPerChunk);
+
+    /**
+     *  Reads the header of a stream written by Write(), and optionally its cull rect.
+     *  Returns false if the stream is not one.
+     */
+    static bool ReadHeader(SkStream* stream, SkRect* cullRect = nullptr);
+
+    /**
+     *  Reads the rest of a stream written by Write() after its header, drawing each chunk to
+     *  canvas as soon as it is read. procs are used as by SkPicture::MakeFromStream(); they may
+     *  be nullptr. Returns false if the stream is corrupt; what was read so far has been drawn.
+     */
+    static bool Play(SkStream* stream, SkCanvas* canvas,
+                     const SkDeserialProcs* procs = nullptr);
+};
+
+#endif
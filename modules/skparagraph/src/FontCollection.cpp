@@ -92,11 +92,16 @@ std::vector<sk_sp<SkTypeface>> FontCollection::findTypefaces(const std::vector<S
 std::vector<sk_sp<SkTypeface>> FontCollection::findTypefaces(const std::vector<SkString>& familyNames, SkFontStyle fontStyle, const std::optional<FontArguments>& fontArgs) {
     // Look inside the font collections cache first
     FamilyKey familyKey(familyNames, fontStyle, fontArgs);
-    auto found = fTypefaces.find(familyKey);
-    if (found) {
-        return *found;
+    {
+        SkAutoMutexExclusive lock(fTypefacesMutex);
+        auto found = fTypefaces.find(familyKey);
+        if (found) {
+            return *found;
+        }
     }
 
+    // Match outside of the lock; font managers are thread safe
+
     std::vector<sk_sp<SkTypeface>> typefaces;
     for (const SkString& familyName : familyNames) {
         sk_sp<SkTypeface> match = matchTypeface(familyName, fontStyle);
@@ -129,6 +134,11 @@ std::vector<sk_sp<SkTypeface>> FontCollection::findTypefaces(const std::vector<S
         }
     }
 
+    SkAutoMutexExclusive lock(fTypefacesMutex);
+    if (auto found = fTypefaces.find(familyKey)) {
+        // Another thread matched the same families first; keep the typefaces it found
+        return *found;
+    }
     fTypefaces.set(familyKey, typefaces);
     return typefaces;
 }
@@ -220,7 +230,10 @@ void FontCollection::enableFontFallback() { fEnableFontFallback = true; }
 
 void FontCollection::clearCaches() {
     fParagraphCache.reset();
-    fTypefaces.reset();
+    {
+        SkAutoMutexExclusive lock(fTypefacesMutex);
+        fTypefaces.reset();
+    }
     SkShapers::HB::PurgeCaches();
 }
 
@@ -301,11 +301,12 @@ bool ParagraphCache::findParagraph(ParagraphImpl* paragraph) {
     if (!fCacheIsOn) {
         return false;
     }
+    // Hash the paragraph before taking the lock; paragraphs can be laid out on several threads
+    ParagraphCacheKey key(paragraph);
+    SkAutoMutexExclusive lock(fParagraphMutex);
 #ifdef PARAGRAPH_CACHE_STATS
     ++fTotalRequests;
 #endif
-    SkAutoMutexExclusive lock(fParagraphMutex);
-    ParagraphCacheKey key(paragraph);
     std::unique_ptr<Entry>* entry = fLRUCacheMap.find(key);
 
     if (!entry) {
@@ -325,12 +326,11 @@ bool ParagraphCache::updateParagraph(ParagraphImpl* paragraph) {
     if (!fCacheIsOn) {
         return false;
     }
+    ParagraphCacheKey key(paragraph);
+    SkAutoMutexExclusive lock(fParagraphMutex);
 #ifdef PARAGRAPH_CACHE_STATS
     ++fTotalRequests;
 #endif
-    SkAutoMutexExclusive lock(fParagraphMutex);
-
-    ParagraphCacheKey key(paragraph);
     std::unique_ptr<Entry>* entry = fLRUCacheMap.find(key);
     if (!entry) {
         // isTooMuchMemoryWasted(paragraph) not needed for now
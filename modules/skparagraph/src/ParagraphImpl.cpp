@@ -1,5 +1,6 @@
 // Copyright 2019 Google LLC.
 #include "include/core/SkCanvas.h"
+#include "include/core/SkFontMgr.h"
 #include "include/core/SkFontMetrics.h"
 #include "include/core/SkMatrix.h"
 #include "include/core/SkPath.h"
@@ -19,13 +20,18 @@
 #include "modules/skparagraph/src/Run.h"
 #include "modules/skparagraph/src/TextLine.h"
 #include "modules/skparagraph/src/TextWrapper.h"
+#include "modules/skshaper/include/SkShaper_harfbuzz.h"
 #include "modules/skunicode/include/SkUnicode.h"
 #include "src/base/SkUTF.h"
+#include "src/core/SkTaskGroup.h"
 #include "src/core/SkTextBlobPriv.h"
 
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <limits>
+#include <optional>
+#include <unordered_set>
 #include <utility>
 
 using namespace skia_private;
@@ -46,8 +52,51 @@ SkScalar littleRound(SkScalar a) {
         return SkScalarFloorToScalar(a);
     }
 }
+
+// Collects the glyphs of a text shaped into a single run
+class SingleRunHandler final : public SkShaper::RunHandler {
+public:
+    void beginLine() override {}
+    void runInfo(const RunInfo&) override {}
+    void commitRunInfo() override {}
+    Buffer runBuffer(const RunInfo& info) override {
+        ++fRunCount;
+        fAdvance = info.fAdvance;
+        fGlyphs.clear();
+        fPositions.clear();
+        fOffsets.clear();
+        fClusters.clear();
+        fGlyphs.push_back_n(info.glyphCount);
+        fPositions.push_back_n(info.glyphCount);
+        fOffsets.push_back_n(info.glyphCount);
+        fClusters.push_back_n(info.glyphCount);
+        return {fGlyphs.data(), fPositions.data(), fOffsets.data(), fClusters.data(), {0, 0}};
+    }
+    void commitRunBuffer(const RunInfo&) override {}
+    void commitLine() override {}
+
+    int fRunCount = 0;
+    SkVector fAdvance = {0, 0};
+    TArray<SkGlyphID, true> fGlyphs;
+    TArray<SkPoint, true> fPositions;
+    TArray<SkPoint, true> fOffsets;
+    TArray<uint32_t, true> fClusters;
+};
 }  // namespace
 
+struct ParagraphImpl::ShapingSource {
+    SkString fText;
+    ParagraphStyle fParagraphStyle;
+    sk_sp<FontCollection> fFontCollection;
+    TArray<Block, true> fTextStyles;
+    int fPlaceholderCount;
+    std::vector<SkUnicode::BidiRegion> fBidiRegions;
+    TArray<Run, false> fRuns;  // share the glyphs with the runs of the source
+    TArray<ResolvedFontDescriptor> fFontSwitches;
+    size_t fUnresolvedGlyphs;
+    std::unordered_set<SkUnichar> fUnresolvedCodepoints;
+};
+
 TextRange operator*(const TextRange& a, const TextRange& b) {
     if (a.start == b.start && a.end == b.end) return a;
     auto begin = std::max(a.start, b.start);
@@ -70,6 +119,16 @@ Paragraph::Paragraph(ParagraphStyle style, sk_sp<FontCollection> fonts)
     SkASSERT(fFontCollection);
 }
 
+void Paragraph::LayoutAll(SkSpan<Paragraph* const> paragraphs,
+                          SkScalar width,
+                          SkExecutor& executor) {
+    SkTaskGroup tasks(executor);
+    tasks.batch(SkToInt(paragraphs.size()), [paragraphs, width](int i) {
+        paragraphs[i]->layout(width);
+    });
+    tasks.wait();
+}
+
 ParagraphImpl::ParagraphImpl(const SkString& text,
                              ParagraphStyle style,
                              TArray<Block, true> blocks,
@@ -169,7 +228,7 @@ void ParagraphImpl::layout(SkScalar rawWidth) {
             this->fClusters.clear();
             this->fClustersIndexFromCodeUnit.clear();
             this->fClustersIndexFromCodeUnit.push_back_n(fText.size() + 1, EMPTY_INDEX);
-            if (!this->shapeTextIntoEndlessLine()) {
+            if (!this->shapeIncrementally() && !this->shapeTextIntoEndlessLine()) {
                 this->resetContext();
                 // TODO: merge the two next calls - they always come together
                 this->resolveStrut();
@@ -197,6 +256,7 @@ void ParagraphImpl::layout(SkScalar rawWidth) {
                 fFontCollection->getParagraphCache()->updateParagraph(this);
             }
         }
+        fShapingSource.reset();
         fState = kShaped;
     }
 
@@ -570,6 +630,254 @@ bool ParagraphImpl::shapeTextIntoEndlessLine() {
     return result;
 }
 
+// Shapes the text by splicing the glyphs of the edited words into the runs of the paragraph
+// given to reuseShapingFrom. The words are shaped with one more word on each side, so the
+// glyphs on both sides of a splice are shaped next to the same text as before.
+// Returns false, leaving everything as it was, if the edit cannot be shaped this way.
+bool ParagraphImpl::shapeIncrementally() {
+    std::unique_ptr<ShapingSource> source = std::move(fShapingSource);
+    if (source == nullptr || fState < kIndexed || fText.size() == 0 ||
+        source->fFontCollection != fFontCollection ||
+        !(source->fParagraphStyle == fParagraphStyle) ||
+        source->fTextStyles.size() != fTextStyles.size() ||
+        // No placeholders other than the one at the end
+        source->fPlaceholderCount != 1 || fPlaceholders.size() != 1 ||
+        source->fBidiRegions.size() != 1 || fBidiRegions.size() != 1 ||
+        source->fBidiRegions[0].level != fBidiRegions[0].level) {
+        return false;
+    }
+
+    // The edit replaces [start, oldEnd) of the old text with [start, newEnd) of the new one
+    const SkString& oldText = source->fText;
+    const size_t commonSize = std::min(oldText.size(), fText.size());
+    size_t start = 0;
+    while (start < commonSize && oldText[start] == fText[start]) {
+        ++start;
+    }
+    size_t suffix = 0;
+    while (suffix < commonSize - start &&
+           oldText[oldText.size() - suffix - 1] == fText[fText.size() - suffix - 1]) {
+        ++suffix;
+    }
+    const size_t oldEnd = oldText.size() - suffix;
+    const size_t newEnd = fText.size() - suffix;
+    const auto delta = SkToS64(fText.size()) - SkToS64(oldText.size());
+    auto shiftIndex = [delta](size_t index) { return SkToSizeT(SkToS64(index) + delta); };
+
+    // Styles must be the same, with the edited text in one of them
+    for (int i = 0; i < fTextStyles.size(); ++i) {
+        const Block& oldBlock = source->fTextStyles[i];
+        const Block& newBlock = fTextStyles[i];
+        auto sameBoundary = [&](size_t oldIndex, size_t newIndex) {
+            if (oldIndex == start && oldIndex == oldEnd) {
+                // Text inserted at the boundary can belong to either side
+                return newIndex == oldIndex || newIndex == shiftIndex(oldIndex);
+            }
+            return oldIndex <= start  ? newIndex == oldIndex
+                 : oldIndex >= oldEnd ? newIndex == shiftIndex(oldIndex)
+                                      : false;
+        };
+        if (!sameBoundary(oldBlock.fRange.start, newBlock.fRange.start) ||
+            !sameBoundary(oldBlock.fRange.end, newBlock.fRange.end) ||
+            !oldBlock.fStyle.equals(newBlock.fStyle) ||
+            // Spacing is already applied to the glyph positions
+            !SkScalarNearlyZero(newBlock.fStyle.getLetterSpacing()) ||
+            !SkScalarNearlyZero(newBlock.fStyle.getWordSpacing())) {
+            return false;
+        }
+    }
+
+    // The run with the edit
+    int runIndex = 0;
+    for (; runIndex < source->fRuns.size(); ++runIndex) {
+        const Run& run = source->fRuns[runIndex];
+        if (run.isPlaceholder()) {
+            return false;
+        }
+        if (run.fTextRange.start <= start && oldEnd <= run.fTextRange.end) {
+            break;
+        }
+    }
+    if (runIndex == source->fRuns.size()) {
+        return false;
+    }
+    const Run& oldRun = source->fRuns[runIndex];
+    if (!oldRun.leftToRight() ||
+        std::find(oldRun.fGlyphs.begin(), oldRun.fGlyphs.end(), 0) != oldRun.fGlyphs.end()) {
+        return false;
+    }
+
+    // Extend the edit to the word before it and the word after it, within the run
+    auto isWhitespace = [this](size_t index) {
+        return this->codeUnitHasProperty(index, SkUnicode::CodeUnitFlags::kPartOfWhiteSpaceBreak);
+    };
+    const size_t runStart = oldRun.fTextRange.start;
+    const size_t runEnd = shiftIndex(oldRun.fTextRange.end);
+    TextRange window(start, newEnd);
+    for (bool whitespace : {false, true, false}) {
+        while (window.start > runStart && isWhitespace(window.start - 1) == whitespace) {
+            --window.start;
+        }
+        while (window.end < runEnd && isWhitespace(window.end) == whitespace) {
+            ++window.end;
+        }
+    }
+    for (size_t i = window.start; i < window.end; ++i) {
+        if (this->codeUnitHasProperty(i, SkUnicode::CodeUnitFlags::kHardLineBreakBefore) ||
+            this->codeUnitHasProperty(i, SkUnicode::CodeUnitFlags::kControl)) {
+            return false;
+        }
+    }
+
+    // The glyphs of the old run that the window replaces
+    auto glyphAt = [&oldRun](size_t textIndex) -> std::optional<size_t> {
+        for (size_t glyph = 0; glyph <= oldRun.size(); ++glyph) {
+            auto index = oldRun.globalClusterIndex(glyph);
+            if (index >= textIndex) {
+                return index == textIndex ? std::optional<size_t>(glyph) : std::nullopt;
+            }
+        }
+        return std::nullopt;
+    };
+    auto oldFirstGlyph = glyphAt(window.start);
+    auto oldLastGlyph = glyphAt(SkToSizeT(SkToS64(window.end) - delta));
+    if (!oldFirstGlyph || !oldLastGlyph) {
+        // A glyph cluster crosses the window
+        return false;
+    }
+
+    // The block the window is in
+    const Block* block = nullptr;
+    for (const Block& b : fTextStyles) {
+        if (b.fRange.start <= window.start && window.end <= b.fRange.end) {
+            block = &b;
+            break;
+        }
+    }
+    if (block == nullptr) {
+        return false;
+    }
+
+    SingleRunHandler shaped;
+    if (window.width() > 0) {
+        auto shaper = SkShapers::HB::ShapeDontWrapOrReorder(fUnicode, SkFontMgr::RefEmpty());
+        if (shaper == nullptr) {
+            return false;
+        }
+        TArray<SkShaper::Feature> features;
+        for (auto& ff : block->fStyle.getFontFeatures()) {
+            if (ff.fName.size() == 4) {
+                features.push_back({
+                    SkSetFourByteTag(ff.fName[0], ff.fName[1], ff.fName[2], ff.fName[3]),
+                    SkToU32(ff.fValue),
+                    0,
+                    window.width()
+                });
+            }
+        }
+        auto text = this->text(window);
+        SkShaper::TrivialFontRunIterator fontIter(oldRun.fFont, text.size());
+        SkShaper::TrivialBiDiRunIterator bidiIter(oldRun.fBidiLevel, text.size());
+        auto scriptIter = SkShapers::HB::ScriptRunIterator(text.begin(), text.size());
+        SkShaper::TrivialLanguageRunIterator langIter(block->fStyle.getLocale().c_str(),
+                                                      text.size());
+        shaper->shape(text.begin(), text.size(),
+                      fontIter, bidiIter, *scriptIter, langIter,
+                      features.data(), features.size(),
+                      std::numeric_limits<SkScalar>::max(), &shaped);
+        if (shaped.fRunCount != 1 ||
+            std::find(shaped.fGlyphs.begin(), shaped.fGlyphs.end(), 0) != shaped.fGlyphs.end()) {
+            return false;
+        }
+    }
+
+    // Splice the new glyphs into the run
+    const size_t firstGlyph = *oldFirstGlyph;
+    const size_t lastGlyph = *oldLastGlyph;
+    const SkScalar windowX = oldRun.posX(firstGlyph);
+    const SkScalar shiftX = shaped.fAdvance.fX - (oldRun.posX(lastGlyph) - windowX);
+    const size_t glyphCount = oldRun.size() - (lastGlyph - firstGlyph) + shaped.fGlyphs.size();
+    const SkShaper::RunHandler::RunInfo info = {
+            oldRun.fFont,
+            oldRun.fBidiLevel,
+            SkVector::Make(oldRun.fAdvance.fX + shiftX, oldRun.fAdvance.fY),
+            glyphCount,
+            SkShaper::RunHandler::Range(oldRun.fUtf8Range.begin(),
+                                        shiftIndex(oldRun.fUtf8Range.size()))
+    };
+    TArray<Run, false> runs;
+    runs.reserve(source->fRuns.size());
+    for (int i = 0; i < runIndex; ++i) {
+        runs.push_back(source->fRuns[i]);
+    }
+    Run& run = runs.emplace_back(this,
+                                 info,
+                                 oldRun.fClusterStart,
+                                 oldRun.fHeightMultiplier,
+                                 oldRun.fUseHalfLeading,
+                                 oldRun.fBaselineShift,
+                                 oldRun.fIndex,
+                                 oldRun.fOffset.fX);
+    size_t glyph = 0;
+    for (size_t i = 0; i < firstGlyph; ++i, ++glyph) {
+        run.fGlyphs[glyph] = oldRun.fGlyphs[i];
+        run.fPositions[glyph] = oldRun.fPositions[i];
+        run.fOffsets[glyph] = oldRun.fOffsets[i];
+        run.fClusterIndexes[glyph] = oldRun.fClusterIndexes[i];
+    }
+    for (int i = 0; i < shaped.fGlyphs.size(); ++i, ++glyph) {
+        run.fGlyphs[glyph] = shaped.fGlyphs[i];
+        run.fPositions[glyph] = shaped.fPositions[i] + SkVector::Make(windowX, 0);
+        run.fOffsets[glyph] = shaped.fOffsets[i];
+        run.fClusterIndexes[glyph] = window.start - oldRun.fClusterStart + shaped.fClusters[i];
+    }
+    for (size_t i = lastGlyph; i < oldRun.size(); ++i, ++glyph) {
+        run.fGlyphs[glyph] = oldRun.fGlyphs[i];
+        run.fPositions[glyph] = oldRun.fPositions[i] + SkVector::Make(shiftX, 0);
+        run.fOffsets[glyph] = oldRun.fOffsets[i];
+        run.fClusterIndexes[glyph] = shiftIndex(oldRun.fClusterIndexes[i]);
+    }
+    SkASSERT(glyph == glyphCount);
+
+    // Move the runs after it
+    for (int i = runIndex + 1; i < source->fRuns.size(); ++i) {
+        const Run& from = source->fRuns[i];
+        const SkShaper::RunHandler::RunInfo fromInfo = {
+                from.fFont, from.fBidiLevel, from.fAdvance, from.size(), from.fUtf8Range
+        };
+        Run& to = runs.emplace_back(this,
+                                    fromInfo,
+                                    shiftIndex(from.fClusterStart),
+                                    from.fHeightMultiplier,
+                                    from.fUseHalfLeading,
+                                    from.fBaselineShift,
+                                    from.fIndex,
+                                    from.fOffset.fX + shiftX);
+        for (size_t j = 0; j < from.size(); ++j) {
+            to.fGlyphs[j] = from.fGlyphs[j];
+            to.fPositions[j] = from.fPositions[j] + SkVector::Make(shiftX, 0);
+            to.fOffsets[j] = from.fOffsets[j];
+            to.fClusterIndexes[j] = from.fClusterIndexes[j];
+        }
+    }
+
+    fRuns = std::move(runs);
+    for (auto& run : fRuns) {
+        run.setOwner(this);
+    }
+    fFontSwitches = std::move(source->fFontSwitches);
+    for (auto& fontSwitch : fFontSwitches) {
+        if (fontSwitch.fTextStart > start) {
+            fontSwitch.fTextStart = shiftIndex(fontSwitch.fTextStart);
+        }
+    }
+    fUnresolvedGlyphs = source->fUnresolvedGlyphs;
+    fUnresolvedCodepoints = std::move(source->fUnresolvedCodepoints);
+
+    this->applySpacingAndBuildClusterTable();
+    return true;
+}
+
 void ParagraphImpl::breakShapedTextIntoLines(SkScalar maxWidth) {
 
     if (!fHasLineBreaks &&
@@ -1120,6 +1428,26 @@ void ParagraphImpl::updateBackgroundPaint(size_t from, size_t to, SkPaint paint)
     }
 }
 
+void ParagraphImpl::reuseShapingFrom(const Paragraph& previous) {
+    // ParagraphImpl is the only implementation of Paragraph
+    const auto& source = static_cast<const ParagraphImpl&>(previous);
+    if (&source == this || fState >= kShaped || source.fState < kShaped) {
+        fShapingSource.reset();
+        return;
+    }
+    fShapingSource = std::make_unique<ShapingSource>(ShapingSource{
+            source.fText,
+            source.fParagraphStyle,
+            source.fFontCollection,
+            source.fTextStyles,
+            source.fPlaceholders.size(),
+            source.fBidiRegions,
+            source.fRuns,
+            source.fFontSwitches,
+            source.fUnresolvedGlyphs,
+            source.fUnresolvedCodepoints});
+}
+
 TArray<TextIndex> ParagraphImpl::countSurroundingGraphemes(TextRange textRange) const {
     textRange = textRange.intersection({0, fText.size()});
     TArray<TextIndex> graphemes;
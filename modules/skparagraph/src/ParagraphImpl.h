@@ -207,6 +207,7 @@ public:
     void updateFontSize(size_t from, size_t to, SkScalar fontSize) override;
     void updateForegroundPaint(size_t from, size_t to, SkPaint paint) override;
     void updateBackgroundPaint(size_t from, size_t to, SkPaint paint) override;
+    void reuseShapingFrom(const Paragraph& previous) override;
 
     void visit(const Visitor&) override;
     void extendedVisit(const ExtendedVisitor&) override;
@@ -257,6 +258,10 @@ private:
 
     void computeEmptyMetrics();
 
+    // The shaping results of the paragraph given to reuseShapingFrom
+    struct ShapingSource;
+    bool shapeIncrementally();
+
     // Input
     skia_private::TArray<StyleBlock<SkScalar>> fLetterSpaceStyles;
     skia_private::TArray<StyleBlock<SkScalar>> fWordSpaceStyles;
@@ -289,6 +294,8 @@ private:
 
     skia_private::TArray<ResolvedFontDescriptor> fFontSwitches;
 
+    std::unique_ptr<ShapingSource> fShapingSource;  // until the first shaping
+
     InternalLineMetrics fEmptyMetrics;
     InternalLineMetrics fStrutMetrics;
 
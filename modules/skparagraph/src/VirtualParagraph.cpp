@@ -0,0 +1,302 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "modules/skparagraph/include/VirtualParagraph.h"
+
+#include "include/core/SkCanvas.h"
+#include "include/private/base/SkTo.h"
+#include "modules/skparagraph/include/Paragraph.h"
+#include "modules/skparagraph/include/ParagraphBuilder.h"
+#include "src/base/SkUTF.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace skia {
+namespace textlayout {
+
+namespace {
+size_t utf8_to_utf16(const char* text, size_t utf8) {
+    return SkToSizeT(std::max(0, SkUTF::UTF8ToUTF16(nullptr, 0, text, utf8)));
+}
+
+size_t utf16_to_utf8(const char* text, size_t size, size_t utf16) {
+    const char* ptr = text;
+    const char* end = text + size;
+    size_t units = 0;
+    while (ptr < end && units < utf16) {
+        SkUnichar unichar = SkUTF::NextUTF8(&ptr, end);
+        if (unichar < 0) {
+            break;
+        }
+        units += SkUTF::ToUTF16(unichar);
+    }
+    return ptr - text;
+}
+}  // namespace
+
+VirtualParagraph::VirtualParagraph(SkString text,
+                                   ParagraphStyle style,
+                                   sk_sp<FontCollection> fonts,
+                                   sk_sp<SkUnicode> unicode)
+        : fText(std::move(text))
+        , fStyle(std::move(style))
+        , fFontCollection(std::move(fonts))
+        , fUnicode(std::move(unicode))
+        , fBuilder(ParagraphBuilder::make(fStyle, fFontCollection, fUnicode))
+        , fLaidOutPieces(0)
+        , fEstimatedPieces(0)
+        , fWidth(0)
+        , fHeight(0)
+        , fMeasuredBytes(0)
+        , fMeasuredWidth(0)
+        , fMeasuredLines(0)
+        , fMeasuredHeight(0) {
+    this->splitIntoPieces();
+}
+
+VirtualParagraph::~VirtualParagraph() = default;
+
+void VirtualParagraph::splitIntoPieces() {
+    const char* text = fText.c_str();
+    size_t start = 0;
+    while (true) {
+        size_t end = start;
+        while (end < fText.size() && text[end] != '\n' && end - start < kMaxPieceBytes) {
+            ++end;
+        }
+        if (end < fText.size() && text[end] != '\n') {
+            // Too long: break the line at the last space, or at least between characters
+            size_t space = end;
+            while (space > start && text[space - 1] != ' ') {
+                --space;
+            }
+            if (space > start) {
+                end = space;
+            } else {
+                size_t boundary = end;
+                while (boundary > start && (text[boundary] & 0xC0) == 0x80) {
+                    --boundary;
+                }
+                // Invalid UTF-8 may have no character boundary at all; cut it anywhere then,
+                // so that every piece makes progress.
+                if (boundary > start) {
+                    end = boundary;
+                }
+            }
+            fPieces.push_back({start, end, 0, 0, false, nullptr});
+            start = end;
+            continue;
+        }
+
+        size_t lineEnd = end;
+        if (lineEnd > start && text[lineEnd - 1] == '\r') {
+            --lineEnd;
+        }
+        fPieces.push_back({start, lineEnd, 0, 0, false, nullptr});
+        if (end == fText.size()) {
+            break;
+        }
+        start = end + 1;
+    }
+    fEstimatedPieces = fPieces.size();
+}
+
+void VirtualParagraph::layout(SkScalar width) {
+    if (width == fWidth && fHeight > 0) {
+        return;
+    }
+    fWidth = width;
+    // Keep the shaped paragraphs; they are broken into lines again when needed
+    fMeasuredBytes = 0;
+    fMeasuredWidth = 0;
+    fMeasuredLines = 0;
+    fMeasuredHeight = 0;
+    for (Piece& piece : fPieces) {
+        piece.fMeasured = false;
+    }
+    fEstimatedPieces = fPieces.size();
+    this->updateTops();
+}
+
+SkScalar VirtualParagraph::estimatedHeight(const Piece& piece) const {
+    SkScalar widthPerByte;
+    SkScalar heightPerLine;
+    if (fMeasuredLines > 0) {
+        widthPerByte = fMeasuredBytes > 0 ? fMeasuredWidth / fMeasuredBytes : 0;
+        heightPerLine = fMeasuredHeight / fMeasuredLines;
+    } else {
+        // Nothing is measured yet: guess from the font size
+        const TextStyle& textStyle = fStyle.getTextStyle();
+        widthPerByte = textStyle.getFontSize() / 2;
+        heightPerLine = textStyle.getFontSize() *
+                        (textStyle.getHeightOverride() ? textStyle.getHeight() : 1.2f);
+    }
+    SkScalar lines = 1;
+    if (fWidth > 0) {
+        lines = std::max(lines, std::ceil((piece.fEnd - piece.fStart) * widthPerByte / fWidth));
+    }
+    return lines * heightPerLine;
+}
+
+void VirtualParagraph::updateTops() {
+    SkScalar top = 0;
+    for (Piece& piece : fPieces) {
+        if (!piece.fMeasured) {
+            piece.fHeight = this->estimatedHeight(piece);
+        }
+        piece.fTop = top;
+        top += piece.fHeight;
+    }
+    fHeight = top;
+}
+
+Paragraph* VirtualParagraph::layoutPiece(size_t index) {
+    Piece& piece = fPieces[index];
+    bool needsLayout = !piece.fMeasured;
+    if (piece.fParagraph == nullptr) {
+        fBuilder->Reset();
+        fBuilder->pushStyle(fStyle.getTextStyle());
+        fBuilder->addText(fText.c_str() + piece.fStart, piece.fEnd - piece.fStart);
+        piece.fParagraph = fBuilder->Build();
+        ++fLaidOutPieces;
+        needsLayout = true;
+    }
+    if (needsLayout) {
+        piece.fParagraph->layout(fWidth);
+    }
+    if (!piece.fMeasured) {
+        piece.fHeight = piece.fParagraph->getHeight();
+        piece.fMeasured = true;
+        --fEstimatedPieces;
+        fMeasuredBytes += piece.fEnd - piece.fStart;
+        fMeasuredWidth += piece.fParagraph->getMaxIntrinsicWidth();
+        fMeasuredLines += std::max<size_t>(1, piece.fParagraph->lineNumber());
+        fMeasuredHeight += piece.fHeight;
+    }
+    return piece.fParagraph.get();
+}
+
+size_t VirtualParagraph::pieceAt(SkScalar y) const {
+    auto found = std::upper_bound(fPieces.begin(), fPieces.end(), y,
+                                  [](SkScalar value, const Piece& piece) {
+                                      return value < piece.fTop;
+                                  });
+    return found == fPieces.begin() ? 0 : found - fPieces.begin() - 1;
+}
+
+size_t VirtualParagraph::pieceContaining(size_t textIndex) const {
+    auto found = std::upper_bound(fPieces.begin(), fPieces.end(), textIndex,
+                                  [](size_t index, const Piece& piece) {
+                                      return index < piece.fStart;
+                                  });
+    return found == fPieces.begin() ? 0 : found - fPieces.begin() - 1;
+}
+
+void VirtualParagraph::releaseDistantPieces(size_t first, size_t last) {
+    size_t top = 0;
+    size_t bottom = fPieces.size();
+    while (fLaidOutPieces > kMaxLaidOutPieces && (top < first || bottom > last + 1)) {
+        bool fromTop = top < first && (bottom <= last + 1 || first - top >= bottom - 1 - last);
+        Piece& piece = fPieces[fromTop ? top++ : --bottom];
+        if (piece.fParagraph != nullptr) {
+            piece.fParagraph.reset();
+            --fLaidOutPieces;
+        }
+    }
+}
+
+SkScalar VirtualParagraph::layoutArea(SkScalar top, SkScalar bottom) {
+    if (fPieces.empty()) {
+        return 0;
+    }
+    const size_t anchor = this->pieceAt(top);
+    const SkScalar anchorTop = fPieces[anchor].fTop;
+
+    const size_t first = this->pieceAt(top - kMargin);
+    size_t last = first;
+    SkScalar y = fPieces[first].fTop;
+    for (size_t i = first; i < fPieces.size() && y < bottom + kMargin; ++i) {
+        this->layoutPiece(i);
+        fPieces[i].fTop = y;
+        y += fPieces[i].fHeight;
+        last = i;
+    }
+    this->updateTops();
+    this->releaseDistantPieces(first, last);
+
+    return fPieces[anchor].fTop - anchorTop;
+}
+
+void VirtualParagraph::paint(SkCanvas* canvas, SkScalar x, SkScalar y) {
+    SkRect clip = canvas->getLocalClipBounds();
+    this->layoutArea(clip.fTop - y, clip.fBottom - y);
+    for (size_t i = this->pieceAt(clip.fTop - y);
+         i < fPieces.size() && fPieces[i].fTop < clip.fBottom - y;
+         ++i) {
+        this->layoutPiece(i)->paint(canvas, x, y + fPieces[i].fTop);
+    }
+}
+
+std::vector<TextBox> VirtualParagraph::getRectsForRange(size_t start,
+                                                        size_t end,
+                                                        RectHeightStyle rectHeightStyle,
+                                                        RectWidthStyle rectWidthStyle) {
+    std::vector<TextBox> boxes;
+    end = std::min(end, fText.size());
+    if (start >= end) {
+        return boxes;
+    }
+
+    const size_t first = this->pieceContaining(start);
+    const size_t last = this->pieceContaining(end - 1);
+    for (size_t i = first; i <= last; ++i) {
+        this->layoutPiece(i);
+    }
+    this->updateTops();
+
+    for (size_t i = first; i <= last; ++i) {
+        const Piece& piece = fPieces[i];
+        const char* text = fText.c_str() + piece.fStart;
+        const size_t from = std::max(start, piece.fStart) - piece.fStart;
+        const size_t to = std::min(end, piece.fEnd) - piece.fStart;
+        if (from >= to) {
+            continue;
+        }
+        auto pieceBoxes = piece.fParagraph->getRectsForRange(SkToUInt(utf8_to_utf16(text, from)),
+                                                             SkToUInt(utf8_to_utf16(text, to)),
+                                                             rectHeightStyle,
+                                                             rectWidthStyle);
+        for (TextBox& box : pieceBoxes) {
+            box.rect.offset(0, piece.fTop);
+            boxes.push_back(box);
+        }
+    }
+    this->releaseDistantPieces(first, last);
+    return boxes;
+}
+
+PositionWithAffinity VirtualParagraph::getGlyphPositionAtCoordinate(SkScalar dx, SkScalar dy) {
+    if (fPieces.empty()) {
+        return {};
+    }
+    size_t index = this->pieceAt(dy);
+    Paragraph* paragraph = this->layoutPiece(index);
+    this->updateTops();
+
+    const Piece& piece = fPieces[index];
+    PositionWithAffinity position =
+            paragraph->getGlyphPositionAtCoordinate(dx, dy - piece.fTop);
+    position.position = SkToS32(piece.fStart +
+                                utf16_to_utf8(fText.c_str() + piece.fStart,
+                                              piece.fEnd - piece.fStart,
+                                              SkToSizeT(std::max(0, position.position))));
+    return position;
+}
+}  // namespace textlayout
+}  // namespace skia
@@ -13,6 +13,7 @@
 #include "include/core/SkBlendMode.h"
 #include "include/core/SkCanvas.h"
 #include "include/core/SkData.h"
+#include "include/core/SkExecutor.h"
 #include "include/core/SkImage.h"
 #include "include/core/SkImageInfo.h"
 #include "include/core/SkMatrix.h"
@@ -21,7 +22,11 @@
 #include "include/core/SkSamplingOptions.h"
 #include "include/core/SkSize.h"
 #include "include/core/SkTypes.h"
+#include "include/private/base/SkMutex.h"
+#include "include/private/base/SkThreadAnnotations.h"
+#include "include/private/base/SkTo.h"
 #include "src/codec/SkCodecImageGenerator.h"
+#include "src/core/SkTaskGroup.h"
 
 #include <algorithm>
 #include <cstddef>
@@ -29,7 +34,44 @@
 #include <utility>
 #include <vector>
 
+namespace {
+// Lets std::condition_variable_any release an SkMutex while it waits, and take it back after.
+struct MutexLockable {
+    SkMutex& fMutex;
+
+    void lock() SK_NO_THREAD_SAFETY_ANALYSIS { fMutex.acquire(); }
+    void unlock() SK_NO_THREAD_SAFETY_ANALYSIS { fMutex.release(); }
+};
+}  // namespace
+
 SkAnimCodecPlayer::SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec) : fCodec(std::move(codec)) {
+    this->init();
+}
+
+SkAnimCodecPlayer::SkAnimCodecPlayer(sk_sp<SkData> data, SkExecutor* executor, int maxReadyFrames)
+        : fCodec(SkCodec::MakeFromData(data))
+        , fData(std::move(data))
+        , fMaxReadyFrames(std::max(maxReadyFrames, 1)) {
+    SkASSERT(executor);
+    if (!fCodec) {
+        fTotalDuration = 0;
+        fImages.push_back(nullptr);
+        return;
+    }
+    this->init();
+
+    if (fTotalDuration > 0) {
+        {
+            SkAutoMutexExclusive lock(fPrefetchMutex);
+            fFrameStates.resize(fFrameInfos.size(), FrameState::kIdle);
+            fWaitingFrames.resize(fFrameInfos.size());
+        }
+        fPrefetchTasks = std::make_unique<SkTaskGroup>(*executor);
+        this->prefetch();
+    }
+}
+
+void SkAnimCodecPlayer::init() {
     fImageInfo = fCodec->getInfo();
     fFrameInfos = fCodec->getFrameInfo();
     fImages.resize(fFrameInfos.size());
@@ -51,7 +93,11 @@ SkAnimCodecPlayer::SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec) : fCodec(st
     }
 }
 
-SkAnimCodecPlayer::~SkAnimCodecPlayer() {}
+SkAnimCodecPlayer::~SkAnimCodecPlayer() {
+    if (fPrefetchTasks) {
+        fPrefetchTasks->wait();
+    }
+}
 
 SkISize SkAnimCodecPlayer::dimensions() const {
     if (!fCodec) {
@@ -67,10 +113,35 @@ SkISize SkAnimCodecPlayer::dimensions() const {
 sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
     SkASSERT((unsigned)index < fFrameInfos.size());
 
+    if (fPrefetchTasks) {
+        ReadyFrames ready;
+        {
+            SkAutoMutexExclusive lock(fPrefetchMutex);
+            this->requestFrame(index, &ready);
+        }
+        this->submitFrames(std::move(ready));
+
+        SkAutoMutexExclusive lock(fPrefetchMutex);
+        MutexLockable lockable{fPrefetchMutex};
+        while (fFrameStates[index] != FrameState::kDecoded) {
+            fFrameDecoded.wait(lockable);
+        }
+        return fImages[index];
+    }
+
     if (fImages[index]) {
         return fImages[index];
     }
 
+    const int requiredFrame = fFrameInfos[index].fRequiredFrame;
+    sk_sp<SkImage> requiredImage = requiredFrame != SkCodec::kNoFrame ? fImages[requiredFrame]
+                                                                      : nullptr;
+    return fImages[index] = this->decodeFrame(fCodec.get(), index, std::move(requiredImage));
+}
+
+sk_sp<SkImage> SkAnimCodecPlayer::decodeFrame(SkCodec* codec,
+                                              int index,
+                                              sk_sp<SkImage> requiredImage) const {
     size_t rb = fImageInfo.minRowBytes();
     size_t size = fImageInfo.computeByteSize(rb);
     auto data = SkData::MakeUninitialized(size);
@@ -78,7 +149,7 @@ sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
     SkCodec::Options opts;
     opts.fFrameIndex = index;
 
-    const auto origin = fCodec->getOrigin();
+    const auto origin = codec->getOrigin();
     const auto orientedDims = this->dimensions();
     const auto originMatrix = SkEncodedOriginToMatrix(origin, orientedDims.width(),
                                                               orientedDims.height());
@@ -90,9 +161,7 @@ sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
     if (fFrameInfos[index].fAlphaType != kOpaque_SkAlphaType && imageInfo.isOpaque()) {
         imageInfo = imageInfo.makeAlphaType(kPremul_SkAlphaType);
     }
-    const int requiredFrame = fFrameInfos[index].fRequiredFrame;
-    if (requiredFrame != SkCodec::kNoFrame && fImages[requiredFrame]) {
-        auto requiredImage = fImages[requiredFrame];
+    if (requiredImage) {
         auto canvas = SkCanvas::MakeRasterDirect(imageInfo, data->writable_data(), rb);
         if (origin != kDefault_SkEncodedOrigin) {
             // The required frame is stored after applying the origin. Undo that,
@@ -107,10 +176,10 @@ sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
             canvas->concat(inverse);
         }
         canvas->drawImage(requiredImage, 0, 0, SkSamplingOptions(), &paint);
-        opts.fPriorFrame = requiredFrame;
+        opts.fPriorFrame = fFrameInfos[index].fRequiredFrame;
     }
 
-    if (SkCodec::kSuccess != fCodec->getPixels(imageInfo, data->writable_data(), rb, &opts)) {
+    if (SkCodec::kSuccess != codec->getPixels(imageInfo, data->writable_data(), rb, &opts)) {
         return nullptr;
     }
 
@@ -125,7 +194,106 @@ sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
         canvas->drawImage(image, 0, 0, SkSamplingOptions(), &paint);
         image = SkImages::RasterFromData(imageInfo, std::move(data), rb);
     }
-    return fImages[index] = image;
+    return image;
+}
+
+bool SkAnimCodecPlayer::inPrefetchWindow(int index) const {
+    const int frameCount = SkToInt(fFrameInfos.size());
+    // The animation loops, so the window wraps around to the first frames.
+    const int distance = (index - fCurrIndex + frameCount) % frameCount;
+    return distance < fMaxReadyFrames;
+}
+
+void SkAnimCodecPlayer::prefetch() {
+    SkASSERT(fPrefetchTasks);
+    ReadyFrames ready;
+    {
+        SkAutoMutexExclusive lock(fPrefetchMutex);
+
+        // Drop decoded frames that playback has moved past. Queued decodes already hold a ref
+        // on the frame they depend on, so this never starves them.
+        const int frameCount = SkToInt(fFrameInfos.size());
+        for (int i = 0; i < frameCount; ++i) {
+            if (fFrameStates[i] == FrameState::kDecoded && !this->inPrefetchWindow(i)) {
+                fFrameStates[i] = FrameState::kIdle;
+                fImages[i] = nullptr;
+            }
+        }
+
+        const int windowSize = std::min(fMaxReadyFrames, frameCount);
+        for (int i = 0; i < windowSize; ++i) {
+            this->requestFrame((fCurrIndex + i) % frameCount, &ready);
+        }
+    }
+    this->submitFrames(std::move(ready));
+}
+
+void SkAnimCodecPlayer::requestFrame(int index, ReadyFrames* ready) {
+    // Walk the dependency chain back to a frame that is decoded, queued, or independent.
+    std::vector<int> chain;
+    for (int i = index; i != SkCodec::kNoFrame && fFrameStates[i] == FrameState::kIdle;
+         i = fFrameInfos[i].fRequiredFrame) {
+        fFrameStates[i] = FrameState::kQueued;
+        chain.push_back(i);
+    }
+
+    // Oldest first, so that each frame either starts now or waits on one queued before it.
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        const int requiredFrame = fFrameInfos[*it].fRequiredFrame;
+        if (requiredFrame == SkCodec::kNoFrame) {
+            ready->push_back({*it, nullptr});
+        } else if (fFrameStates[requiredFrame] == FrameState::kDecoded) {
+            ready->push_back({*it, fImages[requiredFrame]});
+        } else {
+            fWaitingFrames[requiredFrame].push_back(*it);
+        }
+    }
+}
+
+void SkAnimCodecPlayer::submitFrames(ReadyFrames ready) {
+    // Called without holding fPrefetchMutex: the executor may run the task on this thread.
+    for (auto& [index, requiredImage] : ready) {
+        fPrefetchTasks->add([this, index = index, requiredImage = std::move(requiredImage)] {
+            this->decodeQueuedFrame(index, requiredImage);
+        });
+    }
+}
+
+void SkAnimCodecPlayer::decodeQueuedFrame(int index, sk_sp<SkImage> requiredImage) {
+    std::unique_ptr<SkCodec> codec;
+    {
+        SkAutoMutexExclusive lock(fPrefetchMutex);
+        if (!fIdleCodecs.empty()) {
+            codec = std::move(fIdleCodecs.back());
+            fIdleCodecs.pop_back();
+        }
+    }
+    if (!codec) {
+        codec = SkCodec::MakeFromData(fData);
+    }
+
+    // If the required frame failed to decode, the codec falls back to decoding it itself.
+    sk_sp<SkImage> image =
+            codec ? this->decodeFrame(codec.get(), index, std::move(requiredImage)) : nullptr;
+
+    ReadyFrames ready;
+    {
+        SkAutoMutexExclusive lock(fPrefetchMutex);
+        if (codec) {
+            fIdleCodecs.push_back(std::move(codec));
+        }
+
+        SkASSERT(fFrameStates[index] == FrameState::kQueued);
+        fFrameStates[index] = FrameState::kDecoded;
+        fImages[index] = image;
+
+        for (int waiting : fWaitingFrames[index]) {
+            ready.push_back({waiting, image});
+        }
+        fWaitingFrames[index].clear();
+    }
+    fFrameDecoded.notify_all();
+    this->submitFrames(std::move(ready));
 }
 
 sk_sp<SkImage> SkAnimCodecPlayer::getFrame() {
@@ -149,6 +317,9 @@ bool SkAnimCodecPlayer::seek(uint32_t msec) {
                                   });
     int prevIndex = fCurrIndex;
     fCurrIndex = lower - fFrameInfos.begin();
+    if (fPrefetchTasks && fCurrIndex != prevIndex) {
+        this->prefetch();
+    }
     return fCurrIndex != prevIndex;
 }
 
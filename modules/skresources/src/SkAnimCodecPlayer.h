@@ -12,16 +12,35 @@
 #include "include/core/SkImageInfo.h"
 #include "include/core/SkRefCnt.h"
 #include "include/core/SkSize.h"
+#include "include/private/base/SkMutex.h"
+#include "include/private/base/SkThreadAnnotations.h"
 
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
+class SkData;
+class SkExecutor;
 class SkImage;
+class SkTaskGroup;
 
 class SkAnimCodecPlayer {
 public:
     SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec);
+
+    /**
+     *  Creates a player that decodes frames ahead of playback on |executor|, keeping at most
+     *  |maxReadyFrames| decoded frames around the current one.
+     *
+     *  Frames only depend on each other through SkCodec::FrameInfo::fRequiredFrame, so every
+     *  frame whose required frame is already decoded (or that has none, e.g. a key frame that
+     *  redraws the whole canvas) is decoded concurrently, each worker using its own codec
+     *  over |data|. |executor| must outlive the player.
+     */
+    SkAnimCodecPlayer(sk_sp<SkData> data, SkExecutor* executor, int maxReadyFrames);
+
     ~SkAnimCodecPlayer();
 
     /**
@@ -60,7 +79,33 @@ private:
     int                             fCurrIndex = 0;
     uint32_t                        fTotalDuration;
 
+    // Prefetching state. fImages is guarded by fPrefetchMutex when fPrefetchTasks is set.
+    enum class FrameState { kIdle, kQueued, kDecoded };
+
+    sk_sp<SkData>                   fData;
+    int                             fMaxReadyFrames = 0;
+    SkMutex                         fPrefetchMutex;
+    std::vector<FrameState>         fFrameStates SK_GUARDED_BY(fPrefetchMutex);
+    // Frames waiting for their required frame (the index) to be decoded.
+    std::vector<std::vector<int>>   fWaitingFrames SK_GUARDED_BY(fPrefetchMutex);
+    std::vector<std::unique_ptr<SkCodec>> fIdleCodecs SK_GUARDED_BY(fPrefetchMutex);
+    // Notified whenever a frame becomes kDecoded; waited on with fPrefetchMutex.
+    std::condition_variable_any     fFrameDecoded;
+    // Declared last so that in-flight decodes finish before anything else is destroyed.
+    std::unique_ptr<SkTaskGroup>    fPrefetchTasks;
+
+    void init();
     sk_sp<SkImage> getFrameAt(int index);
+    sk_sp<SkImage> decodeFrame(SkCodec*, int index, sk_sp<SkImage> requiredImage) const;
+
+    // Frames whose required frame is available, paired with its image.
+    using ReadyFrames = std::vector<std::pair<int, sk_sp<SkImage>>>;
+
+    void prefetch();
+    void requestFrame(int index, ReadyFrames*) SK_REQUIRES(fPrefetchMutex);
+    void submitFrames(ReadyFrames);
+    void decodeQueuedFrame(int index, sk_sp<SkImage> requiredImage);
+    bool inPrefetchWindow(int index) const;
 };
 
 #endif
@@ -43,6 +43,8 @@
 #include <hb-ot.h>
 #include <hb.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <memory>
@@ -326,6 +328,8 @@ HBFont create_typeface_hb_font(const SkTypeface& typeface) {
                                    axis_count);
         }
     }
+    // The font is shared by every thread shaping with this typeface.
+    hb_font_make_immutable(otFont.get());
 
     return otFont;
 }
@@ -1239,38 +1243,136 @@ void ShapeDontWrapOrReorder::wrap(char const * const utf8, size_t utf8Bytes,
     handler->commitLine();
 }
 
-class HBLockedFaceCache {
+template <typename K, typename V> class HBLockedCache {
 public:
-    HBLockedFaceCache(SkLRUCache<SkTypefaceID, HBFont>& lruCache, SkMutex& mutex)
+    HBLockedCache(SkLRUCache<K, V>& lruCache, SkMutex& mutex)
         : fLRUCache(lruCache), fMutex(mutex)
     {
         fMutex.acquire();
     }
-    HBLockedFaceCache(const HBLockedFaceCache&) = delete;
-    HBLockedFaceCache& operator=(const HBLockedFaceCache&) = delete;
-    HBLockedFaceCache& operator=(HBLockedFaceCache&&) = delete;
+    HBLockedCache(const HBLockedCache&) = delete;
+    HBLockedCache& operator=(const HBLockedCache&) = delete;
+    HBLockedCache& operator=(HBLockedCache&&) = delete;
 
-    ~HBLockedFaceCache() {
+    ~HBLockedCache() {
         fMutex.release();
     }
 
-    HBFont* find(SkTypefaceID fontId) {
-        return fLRUCache.find(fontId);
+    V* find(const K& key) {
+        return fLRUCache.find(key);
     }
-    HBFont* insert(SkTypefaceID fontId, HBFont hbFont) {
-        return fLRUCache.insert(fontId, std::move(hbFont));
+    V* insert(const K& key, V value) {
+        return fLRUCache.insert(key, std::move(value));
+    }
+    void setMaxCount(int maxCount) {
+        fLRUCache.setMaxCount(maxCount);
     }
     void reset() {
         fLRUCache.reset();
     }
 private:
-    SkLRUCache<SkTypefaceID, HBFont>& fLRUCache;
+    SkLRUCache<K, V>& fLRUCache;
     SkMutex& fMutex;
 };
-static HBLockedFaceCache get_hbFace_cache() {
-    static SkMutex gHBFaceCacheMutex;
-    static SkLRUCache<SkTypefaceID, HBFont> gHBFaceCache(100);
-    return HBLockedFaceCache(gHBFaceCache, gHBFaceCacheMutex);
+// The typeface fonts are split between shards by typeface ID, so that threads shaping with
+// different typefaces rarely wait on each other.
+using HBLockedFaceCache = HBLockedCache<SkTypefaceID, HBFont>;
+constexpr int kHBFaceCacheShardCount = 8;
+// The default size of 100 is completely arbitrary and used to match libtxt.
+constexpr int kDefaultHBFaceCacheLimit = 100;
+static std::atomic<int> gHBFaceCacheLimit{kDefaultHBFaceCacheLimit};
+static std::atomic<size_t> gHBFaceCacheHits{0};
+static std::atomic<size_t> gHBFaceCacheMisses{0};
+
+constexpr int hbFace_cache_shard_limit(int limit) {
+    return (limit + kHBFaceCacheShardCount - 1) / kHBFaceCacheShardCount;
+}
+
+struct HBFaceCacheShard {
+    SkMutex fMutex;
+    SkLRUCache<SkTypefaceID, HBFont> fCache{hbFace_cache_shard_limit(kDefaultHBFaceCacheLimit)};
+};
+static HBFaceCacheShard* get_hbFace_cache_shards() {
+    static HBFaceCacheShard* gShards = new HBFaceCacheShard[kHBFaceCacheShardCount];
+    return gShards;
+}
+static HBLockedFaceCache get_hbFace_cache(SkTypefaceID typefaceID) {
+    HBFaceCacheShard& shard = get_hbFace_cache_shards()[typefaceID % kHBFaceCacheShardCount];
+    return HBLockedFaceCache(shard.fCache, shard.fMutex);
+}
+
+// The glyphs of a shaped run, with clusters relative to the start of the run.
+struct CachedShapedRun {
+    std::unique_ptr<ShapedGlyph[]> fGlyphs;
+    size_t fNumGlyphs;
+    SkVector fAdvance;
+};
+// UI text repeats the same short runs, so keep the result of shaping them. Longer runs are
+// unlikely to repeat and are not cached.
+constexpr size_t kMaxCachedRunBytes = 256;
+using HBLockedShapedRunCache = HBLockedCache<SkString, CachedShapedRun>;
+static HBLockedShapedRunCache get_shapedRun_cache() {
+    static SkMutex gShapedRunCacheMutex;
+    static SkLRUCache<SkString, CachedShapedRun> gShapedRunCache(1024);
+    return HBLockedShapedRunCache(gShapedRunCache, gShapedRunCacheMutex);
+}
+
+// HarfBuzz keeps at most this many code points of context on each side of the run
+// (HB_BUFFER_CONTEXT_LENGTH), so only these can affect the result.
+constexpr int kHBContextLength = 5;
+
+// Everything hb_shape and the conversion of its output depend on.
+SkString shaped_run_key(const char* utf8, size_t utf8Bytes,
+                        const char* utf8Start, const char* utf8End,
+                        const SkFont& font, hb_buffer_t* buffer,
+                        SkSpan<const hb_feature_t> hbFeatures) {
+    SkString key;
+    auto append = [&key](const auto& value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    append(font.getTypeface()->uniqueID());
+    append(font.getSize());
+    append(font.getScaleX());
+    append(font.getSkewX());
+    append(font.getEdging());
+    append(font.getHinting());
+    append((font.isForceAutoHinting() ? 1u << 0 : 0) |
+           (font.isEmbeddedBitmaps()  ? 1u << 1 : 0) |
+           (font.isSubpixel()         ? 1u << 2 : 0) |
+           (font.isLinearMetrics()    ? 1u << 3 : 0) |
+           (font.isEmbolden()         ? 1u << 4 : 0) |
+           (font.isBaselineSnap()     ? 1u << 5 : 0));
+
+    append(hb_buffer_get_direction(buffer));
+    append(hb_buffer_get_script(buffer));
+    append(hb_buffer_get_language(buffer));
+
+    const unsigned runStart = SkTo<unsigned>(utf8Start - utf8);
+    append(hbFeatures.size());
+    for (const hb_feature_t& feature : hbFeatures) {
+        append(feature.tag);
+        append(feature.value);
+        append(feature.start == HB_FEATURE_GLOBAL_START ? feature.start
+                                                        : feature.start - runStart);
+        append(feature.end == HB_FEATURE_GLOBAL_END ? feature.end : feature.end - runStart);
+    }
+
+    const char* contextStart = utf8Start;
+    for (int i = 0; i < kHBContextLength && contextStart > utf8; ++i) {
+        do {
+            --contextStart;
+        } while (contextStart > utf8 && (*contextStart & 0xC0) == 0x80);
+    }
+    const char* contextEnd = utf8End;
+    for (int i = 0; i < kHBContextLength && contextEnd < utf8 + utf8Bytes; ++i) {
+        utf8_next(&contextEnd, utf8 + utf8Bytes);
+    }
+    append(SkTo<uint32_t>(utf8Start - contextStart));
+    append(SkTo<uint32_t>(utf8End - utf8Start));
+    key.append(contextStart, contextEnd - contextStart);
+
+    return key;
 }
 
 ShapedRun ShaperHarfBuzz::shape(char const * const utf8,
@@ -1324,26 +1426,6 @@ ShapedRun ShaperHarfBuzz::shape(char const * const utf8,
     hb_buffer_set_language(buffer, hbLanguage);
     hb_buffer_guess_segment_properties(buffer);
 
-    // TODO: better cache HBFace (data) / hbfont (typeface)
-    // An HBFace is expensive (it sanitizes the bits).
-    // An HBFont is fairly inexpensive.
-    // An HBFace is actually tied to the data, not the typeface.
-    // The size of 100 here is completely arbitrary and used to match libtxt.
-    HBFont hbFont;
-    {
-        HBLockedFaceCache cache = get_hbFace_cache();
-        SkTypefaceID dataId = font.currentFont().getTypeface()->uniqueID();
-        HBFont* typefaceFontCached = cache.find(dataId);
-        if (!typefaceFontCached) {
-            HBFont typefaceFont(create_typeface_hb_font(*font.currentFont().getTypeface()));
-            typefaceFontCached = cache.insert(dataId, std::move(typefaceFont));
-        }
-        hbFont = create_sub_hb_font(font.currentFont(), *typefaceFontCached);
-    }
-    if (!hbFont) {
-        return run;
-    }
-
     STArray<32, hb_feature_t> hbFeatures;
     for (const auto& feature : SkSpan(features, featuresSize)) {
         if (feature.end < SkTo<size_t>(utf8Start - utf8) ||
@@ -1362,6 +1444,52 @@ ShapedRun ShaperHarfBuzz::shape(char const * const utf8,
         }
     }
 
+    SkString cacheKey;
+    if (utf8runLength <= kMaxCachedRunBytes) {
+        cacheKey = shaped_run_key(utf8, utf8Bytes, utf8Start, utf8End, font.currentFont(),
+                                  buffer, hbFeatures);
+        HBLockedShapedRunCache cache = get_shapedRun_cache();
+        if (const CachedShapedRun* cached = cache.find(cacheKey)) {
+            run = ShapedRun(RunHandler::Range(utf8Start - utf8, utf8runLength),
+                            font.currentFont(), bidi.currentLevel(),
+                            std::unique_ptr<ShapedGlyph[]>(new ShapedGlyph[cached->fNumGlyphs]),
+                            cached->fNumGlyphs, cached->fAdvance);
+            for (size_t i = 0; i < cached->fNumGlyphs; ++i) {
+                run.fGlyphs[i] = cached->fGlyphs[i];
+                run.fGlyphs[i].fCluster += utf8Start - utf8;
+            }
+            return run;
+        }
+    }
+
+    // TODO: better cache HBFace (data) / hbfont (typeface)
+    // An HBFace is expensive (it sanitizes the bits).
+    // An HBFont is fairly inexpensive.
+    // An HBFace is actually tied to the data, not the typeface.
+    HBFont hbFont;
+    SkTypefaceID dataId = font.currentFont().getTypeface()->uniqueID();
+    {
+        HBLockedFaceCache cache = get_hbFace_cache(dataId);
+        if (HBFont* typefaceFontCached = cache.find(dataId)) {
+            gHBFaceCacheHits.fetch_add(1, std::memory_order_relaxed);
+            hbFont = create_sub_hb_font(font.currentFont(), *typefaceFontCached);
+        }
+    }
+    if (!hbFont) {
+        gHBFaceCacheMisses.fetch_add(1, std::memory_order_relaxed);
+        // Create the face without holding the lock; another thread may add the same one first.
+        HBFont typefaceFont(create_typeface_hb_font(*font.currentFont().getTypeface()));
+        HBLockedFaceCache cache = get_hbFace_cache(dataId);
+        HBFont* typefaceFontCached = cache.find(dataId);
+        if (!typefaceFontCached) {
+            typefaceFontCached = cache.insert(dataId, std::move(typefaceFont));
+        }
+        hbFont = create_sub_hb_font(font.currentFont(), *typefaceFontCached);
+    }
+    if (!hbFont) {
+        return run;
+    }
+
     hb_shape(hbFont.get(), buffer, hbFeatures.data(), hbFeatures.size());
     unsigned len = hb_buffer_get_length(buffer);
     if (len == 0) {
@@ -1413,6 +1541,19 @@ ShapedRun ShaperHarfBuzz::shape(char const * const utf8,
     }
     run.fAdvance = runAdvance;
 
+    if (!cacheKey.isEmpty()) {
+        CachedShapedRun cached{std::unique_ptr<ShapedGlyph[]>(new ShapedGlyph[len]), len,
+                               runAdvance};
+        for (unsigned i = 0; i < len; i++) {
+            cached.fGlyphs[i] = run.fGlyphs[i];
+            cached.fGlyphs[i].fCluster -= utf8Start - utf8;
+        }
+        HBLockedShapedRunCache cache = get_shapedRun_cache();
+        if (!cache.find(cacheKey)) {
+            cache.insert(cacheKey, std::move(cached));
+        }
+    }
+
     return run;
 }
 }  // namespace
@@ -1529,8 +1670,34 @@ std::unique_ptr<SkShaper::ScriptRunIterator> ScriptRunIterator(const char* utf8,
             utf8, utf8Bytes, hb_script_from_iso15924_tag((hb_tag_t)script));
 }
 
+int GetFaceCacheLimit() {
+    return gHBFaceCacheLimit.load(std::memory_order_relaxed);
+}
+
+int SetFaceCacheLimit(int count) {
+    // Each shard keeps at least one font.
+    count = std::max(count, kHBFaceCacheShardCount);
+    int previous = gHBFaceCacheLimit.exchange(count, std::memory_order_relaxed);
+    HBFaceCacheShard* shards = get_hbFace_cache_shards();
+    for (int i = 0; i < kHBFaceCacheShardCount; ++i) {
+        HBLockedFaceCache cache(shards[i].fCache, shards[i].fMutex);
+        cache.setMaxCount(hbFace_cache_shard_limit(count));
+    }
+    return previous;
+}
+
+FaceCacheStats GetFaceCacheStats() {
+    return { gHBFaceCacheHits.load(std::memory_order_relaxed),
+             gHBFaceCacheMisses.load(std::memory_order_relaxed) };
+}
+
 void PurgeCaches() {
-    HBLockedFaceCache cache = get_hbFace_cache();
+    HBFaceCacheShard* shards = get_hbFace_cache_shards();
+    for (int i = 0; i < kHBFaceCacheShardCount; ++i) {
+        HBLockedFaceCache cache(shards[i].fCache, shards[i].fMutex);
+        cache.reset();
+    }
+    HBLockedShapedRunCache cache = get_shapedRun_cache();
     cache.reset();
 }
 }  // namespace SkShapers::HB
@@ -7,12 +7,14 @@
 
 #include "src/codec/SkPngCodec.h"
 
+#include "include/codec/SkEncodedImageFormat.h"
 #include "include/codec/SkEncodedOrigin.h"
 #include "include/codec/SkPngChunkReader.h"
 #include "include/codec/SkPngDecoder.h"
 #include "include/core/SkColorSpace.h"
 #include "include/core/SkData.h"
 #include "include/core/SkImageInfo.h"
+#include "include/core/SkPixmap.h"
 #include "include/core/SkRect.h"
 #include "include/core/SkSize.h"
 #include "include/core/SkSpan.h"
@@ -23,6 +25,7 @@
 #include "include/private/base/SkNoncopyable.h"
 #include "include/private/base/SkTemplates.h"
 #include "modules/skcms/skcms.h"
+#include "src/base/SkSafeMath.h"
 #include "src/codec/SkCodecPriv.h"
 #include "src/codec/SkPngCompositeChunkReader.h"
 #include "src/codec/SkPngPriv.h"
@@ -397,6 +400,13 @@ static SkCodec::Result log_and_return_error(bool success) {
     return SkCodec::kErrorInInput;
 }
 
+// Returns the first `rows` rows of `band`.
+static SkPixmap top_rows(const SkPixmap& band, int rows) {
+    SkASSERT(rows > 0 && rows <= band.height());
+    return SkPixmap(band.info().makeDimensions({band.width(), rows}), band.addr(),
+                    band.rowBytes());
+}
+
 class SkPngNormalDecoder : public SkPngCodec {
 public:
     SkPngNormalDecoder(SkEncodedInfo&& info,
@@ -427,6 +437,10 @@ public:
         GetDecoder(png_ptr)->rowCallback(row, rowNum);
     }
 
+    static void BandRowCallback(png_structp png_ptr, png_bytep row, png_uint_32 rowNum, int) {
+        GetDecoder(png_ptr)->bandRowCallback(row, rowNum);
+    }
+
 private:
     int                         fRowsWrittenToOutput;
     void*                       fDst;
@@ -437,6 +451,12 @@ private:
     int                         fLastRow;
     int                         fRowsNeeded;
 
+    // Variables for band decode
+    const SkPixmap*             fBand = nullptr;
+    SkPngDecoder::BandSink*     fBandSink = nullptr;
+    int                         fBandTop = 0;
+    bool                        fBandSinkStopped = false;
+
     static SkPngNormalDecoder* GetDecoder(png_structp png_ptr) {
         return static_cast<SkPngNormalDecoder*>(png_get_progressive_ptr(png_ptr));
     }
@@ -520,6 +540,65 @@ private:
             longjmp(PNG_JMPBUF(this->png_ptr()), kStopDecoding);
         }
     }
+
+    Result decodeAllBands(const SkImageInfo& dstInfo,
+                          const Options& options,
+                          const SkPixmap& band,
+                          SkPngDecoder::BandSink* sink) override {
+        // Let startIncrementalDecode rewind and set up the xforms. Rows are then routed
+        // through BandRowCallback, so the whole image is read in a single pass.
+        Result result = this->startIncrementalDecode(dstInfo, band.writable_addr(),
+                                                     band.rowBytes(), &options);
+        if (kSuccess != result) {
+            return result;
+        }
+        this->initializeXformParams();
+        png_set_progressive_read_fn(this->png_ptr(), this, nullptr, BandRowCallback, nullptr);
+
+        fBand = &band;
+        fBandSink = sink;
+        fBandTop = 0;
+        fBandSinkStopped = false;
+        fRowsWrittenToOutput = 0;
+
+        const bool success = this->processData();
+
+        // Hand over whatever was decoded of a band cut short by truncated input.
+        if (!fBandSinkStopped && fRowsWrittenToOutput > fBandTop) {
+            fBandSinkStopped = !sink->onBand(fBandTop,
+                                             top_rows(band, fRowsWrittenToOutput - fBandTop));
+        }
+        fBand = nullptr;
+        fBandSink = nullptr;
+
+        if (fBandSinkStopped ||
+            (success && fRowsWrittenToOutput == this->dimensions().height())) {
+            return kSuccess;
+        }
+        return log_and_return_error(success);
+    }
+
+    void bandRowCallback(png_bytep row, int rowNum) {
+        SkASSERT(rowNum == fRowsWrittenToOutput);
+        const int bandRow = rowNum - fBandTop;
+        this->applyXformRow(fBand->writable_addr(0, bandRow), row);
+        fRowsWrittenToOutput++;
+
+        if (bandRow + 1 == fBand->height() || fRowsWrittenToOutput == this->dimensions().height()) {
+            bool keepGoing;
+            {
+                // Scoped so that the pixmap is destroyed before a possible longjmp.
+                const SkPixmap rows = top_rows(*fBand, bandRow + 1);
+                keepGoing = fBandSink->onBand(fBandTop, rows);
+            }
+            fBandTop = fRowsWrittenToOutput;
+            if (!keepGoing) {
+                fBandSinkStopped = true;
+                // Fake error to stop decoding scanlines.
+                longjmp(PNG_JMPBUF(this->png_ptr()), kStopDecoding);
+            }
+        }
+    }
 };
 
 class SkPngInterlacedDecoder : public SkPngCodec {
@@ -684,6 +763,42 @@ private:
         return log_and_return_error(success);
     }
 
+    Result decodeAllBands(const SkImageInfo& dstInfo,
+                          const Options& options,
+                          const SkPixmap& band,
+                          SkPngDecoder::BandSink* sink) override {
+        // No row is final before the last Adam7 pass, so each band is a separate subset decode.
+        // setRange sizes fInterlaceBuffer to the band, which keeps memory bounded, at the cost
+        // of rewinding and re-inflating the image data (up to the band) once per band.
+        const int height = dstInfo.height();
+        for (int top = 0; top < height; top += band.height()) {
+            const int rows = std::min(band.height(), height - top);
+            const SkIRect subset = SkIRect::MakeXYWH(0, top, dstInfo.width(), rows);
+            Options bandOptions = options;
+            bandOptions.fSubset = &subset;
+
+            Result result = this->startIncrementalDecode(dstInfo, band.writable_addr(),
+                                                         band.rowBytes(), &bandOptions);
+            if (kSuccess != result) {
+                return result;
+            }
+
+            int rowsDecoded = rows;
+            result = this->incrementalDecode(&rowsDecoded);
+            if (kSuccess != result) {
+                if (rowsDecoded > 0) {
+                    sink->onBand(top, top_rows(band, rowsDecoded));
+                }
+                return result;
+            }
+
+            if (!sink->onBand(top, top_rows(band, rows))) {
+                break;
+            }
+        }
+        return kSuccess;
+    }
+
     Result setUpInterlaceBuffer(int height) {
         fPng_rowbytes = png_get_rowbytes(this->png_ptr(), this->info_ptr());
         size_t interlaceBufferSize = fPng_rowbytes * height;
@@ -1038,6 +1153,43 @@ SkCodec::Result SkPngCodec::onIncrementalDecode(int* rowsDecoded) {
     return this->decode(rowsDecoded);
 }
 
+SkCodec::Result SkPngCodec::decodeBands(const SkImageInfo& dstInfo,
+                                        int bandHeight,
+                                        SkPngDecoder::BandSink* sink,
+                                        const Options& options) {
+    if (!sink || bandHeight <= 0) {
+        return kInvalidParameters;
+    }
+    if (options.fSubset) {
+        return kUnimplemented;
+    }
+    if (dstInfo.dimensions() != this->dimensions()) {
+        return kInvalidScale;
+    }
+
+    bandHeight = std::min(bandHeight, dstInfo.height());
+    const size_t rowBytes = dstInfo.minRowBytes();
+    SkSafeMath safe;
+    const size_t bandSize = safe.mul(rowBytes, bandHeight);
+    if (!safe || !bandSize) {
+        return kInvalidParameters;
+    }
+    std::unique_ptr<void, SkOverloadedFunctionObject<void(void*), sk_free>> storage(
+            sk_malloc_canfail(bandSize));
+    if (!storage) {
+        return kInternalError;
+    }
+    const SkPixmap band(dstInfo.makeDimensions({dstInfo.width(), bandHeight}),
+                        storage.get(), rowBytes);
+
+    const Result result = this->decodeAllBands(dstInfo, options, band, sink);
+
+    // The incremental decode that was set up by decodeAllBands points into `band`, which is
+    // about to be freed, so it must not be resumed.
+    fStartedIncrementalDecode = false;
+    return result;
+}
+
 std::unique_ptr<SkCodec> SkPngCodec::MakeFromStream(std::unique_ptr<SkStream> stream,
                                                     Result* result, SkPngChunkReader* chunkReader) {
     SkASSERT(result);
@@ -1142,4 +1294,17 @@ std::unique_ptr<SkCodec> Decode(sk_sp<SkData> data,
     }
     return Decode(SkMemoryStream::Make(std::move(data)), outResult, ctx);
 }
+
+SkCodec::Result DecodeBands(SkCodec* codec,
+                            const SkImageInfo& dstInfo,
+                            int bandHeight,
+                            BandSink* sink,
+                            const SkCodec::Options* options) {
+    if (!codec || codec->getEncodedFormat() != SkEncodedImageFormat::kPNG) {
+        return SkCodec::kInvalidParameters;
+    }
+    SkCodec::Options defaultOptions;
+    return static_cast<SkPngCodec*>(codec)->decodeBands(dstInfo, bandHeight, sink,
+                                                        options ? *options : defaultOptions);
+}
 }  // namespace SkPngDecoder
@@ -17,6 +17,7 @@
 #include "include/private/SkGainmapInfo.h"
 #include "src/codec/SkPngCodecBase.h"
 
+class SkPixmap;
 class SkPngChunkReader;
 class SkPngCompositeChunkReader;
 class SkStream;
@@ -24,6 +25,10 @@ struct SkEncodedInfo;
 struct SkImageInfo;
 template <typename T> class SkSpan;
 
+namespace SkPngDecoder {
+class BandSink;
+}
+
 class SkPngCodec : public SkPngCodecBase {
 public:
     static bool IsPng(const void*, size_t);
@@ -39,6 +44,12 @@ public:
 
     bool onGetGainmapInfo(SkGainmapInfo*) override;
 
+    // Implements SkPngDecoder::DecodeBands.
+    Result decodeBands(const SkImageInfo& dstInfo,
+                       int bandHeight,
+                       SkPngDecoder::BandSink*,
+                       const Options&);
+
     ~SkPngCodec() override;
 
 protected:
@@ -100,6 +111,11 @@ private:
     virtual Result decodeAllRows(void* dst, size_t rowBytes, int* rowsDecoded) = 0;
     virtual Result setRange(int firstRow, int lastRow, void* dst, size_t rowBytes) = 0;
     virtual Result decode(int* rowsDecoded) = 0;
+    // Decodes the image into `band`, one band at a time, handing each to the sink.
+    virtual Result decodeAllBands(const SkImageInfo& dstInfo,
+                                  const Options&,
+                                  const SkPixmap& band,
+                                  SkPngDecoder::BandSink*) = 0;
 
     size_t                         fIdatLength;
     bool                           fDecodedIdat;
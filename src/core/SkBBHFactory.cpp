@@ -8,12 +8,17 @@
 #include "include/core/SkBBHFactory.h"
 
 #include "include/core/SkRect.h"
+#include "src/core/SkHilbertRTree.h"
 #include "src/core/SkRTree.h"
 
 sk_sp<SkBBoxHierarchy> SkRTreeFactory::operator()() const {
     return sk_make_sp<SkRTree>();
 }
 
+sk_sp<SkBBoxHierarchy> SkHilbertRTreeFactory::operator()() const {
+    return sk_make_sp<SkHilbertRTree>();
+}
+
 void SkBBoxHierarchy::insert(const SkRect rects[], const Metadata[], int N) {
     // Ignore Metadata.
     this->insert(rects, N);
@@ -16,6 +16,7 @@
 #include "src/core/SkOpts.h"
 #include "src/core/SkResourceCache.h"
 #include "src/core/SkStrikeCache.h"
+#include "src/core/SkStrikeDiskCache.h"
 #include "src/core/SkSwizzlePriv.h"
 #include "src/core/SkTypefaceCache.h"
 
@@ -65,6 +66,15 @@ int SkGraphics::SetFontCacheCountLimit(int count) {
     return SkStrikeCache::GlobalStrikeCache()->setCacheCountLimit(count);
 }
 
+void SkGraphics::SetFontCacheDirectory(const char directory[]) {
+    SkStrikeCache::GlobalStrikeCache()->setDiskCache(
+            directory ? sk_make_sp<SkStrikeDiskCache>(directory) : nullptr);
+}
+
+int SkGraphics::WriteFontCacheToDirectory() {
+    return SkStrikeCache::GlobalStrikeCache()->storeToDiskCache();
+}
+
 int SkGraphics::GetFontCacheCountUsed() {
     return SkStrikeCache::GlobalStrikeCache()->getCacheCountUsed();
 }
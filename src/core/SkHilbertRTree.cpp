@@ -0,0 +1,175 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "src/core/SkHilbertRTree.h"
+
+#include "include/core/SkScalar.h"
+#include "include/private/base/SkTPin.h"
+#include "src/base/SkVx.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace {
+using Edges = skvx::Vec<SkHilbertRTree::kNodeSize, float>;
+
+// Distance of (x, y) along the Hilbert curve that fills a 65536 x 65536 grid.
+uint32_t hilbert_distance(uint32_t x, uint32_t y) {
+    constexpr uint32_t kLast = 0xFFFF;
+    uint32_t d = 0;
+    for (uint32_t s = 1 << 15; s > 0; s >>= 1) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = kLast - x;
+                y = kLast - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+int round_up_to_node(int count) {
+    return (count + SkHilbertRTree::kNodeSize - 1) & ~(SkHilbertRTree::kNodeSize - 1);
+}
+}  // namespace
+
+SkHilbertRTree::SkHilbertRTree() {}
+
+void SkHilbertRTree::insert(const SkRect boundsArray[], int N) {
+    SkASSERT(N >= 0);
+
+    // Start over, keeping the memory of the last insert().
+    fLevels.clear();
+    fOpIndices.clear();
+    std::vector<Leaf>& leaves = fLeaves;
+    leaves.clear();
+    leaves.reserve(N);
+    SkRect extent = SkRect::MakeEmpty();
+    for (int i = 0; i < N; i++) {
+        // Empty bounds can never intersect a query, so skip them, as SkRTree does.
+        if (!boundsArray[i].isEmpty()) {
+            leaves.push_back({0, i});
+            extent.join(boundsArray[i]);
+        }
+    }
+    if (leaves.empty()) {
+        return;
+    }
+
+    // Map the centers onto the Hilbert grid; rects that share a cell keep their order.
+    const float scaleX = extent.width()  > 0 ? 0xFFFF / extent.width()  : 0;
+    const float scaleY = extent.height() > 0 ? 0xFFFF / extent.height() : 0;
+    for (Leaf& leaf : leaves) {
+        const SkRect& r = boundsArray[leaf.fOpIndex];
+        float x = (r.centerX() - extent.fLeft) * scaleX;
+        float y = (r.centerY() - extent.fTop)  * scaleY;
+        leaf.fDistance = hilbert_distance((uint32_t)SkTPin(x, 0.0f, 65535.0f),
+                                          (uint32_t)SkTPin(y, 0.0f, 65535.0f));
+    }
+    // Leaves are in op order, so breaking ties by op keeps it without stable_sort's buffer.
+    std::sort(leaves.begin(), leaves.end(), [](const Leaf& a, const Leaf& b) {
+        return a.fDistance != b.fDistance ? a.fDistance < b.fDistance
+                                          : a.fOpIndex < b.fOpIndex;
+    });
+
+    // Count the entries of every level to allocate the edges at once.
+    int total = 0;
+    for (int count = SkToInt(leaves.size());; count = round_up_to_node(count) / kNodeSize) {
+        fLevels.push_back(total);
+        total += round_up_to_node(count);
+        if (count <= kNodeSize) {
+            break;
+        }
+    }
+    SkASSERT(fLevels.size() <= kMaxDepth);
+    fLeft  .assign(total,  SK_ScalarInfinity);
+    fTop   .assign(total,  SK_ScalarInfinity);
+    fRight .assign(total, SK_ScalarNegativeInfinity);
+    fBottom.assign(total, SK_ScalarNegativeInfinity);
+
+    fOpIndices.reserve(leaves.size());
+    for (const Leaf& leaf : leaves) {
+        const SkRect& r = boundsArray[leaf.fOpIndex];
+        const int i = SkToInt(fOpIndices.size());
+        fLeft[i]   = r.fLeft;
+        fTop[i]    = r.fTop;
+        fRight[i]  = r.fRight;
+        fBottom[i] = r.fBottom;
+        fOpIndices.push_back(leaf.fOpIndex);
+    }
+
+    // Each entry of a level bounds a node of the level below.
+    for (size_t level = 1; level < fLevels.size(); ++level) {
+        const int children = fLevels[level - 1];
+        const int parents  = fLevels[level];
+        const int count = (parents - children) / kNodeSize;
+        for (int i = 0; i < count; ++i) {
+            const int node = children + i * kNodeSize;
+            fLeft  [parents + i] = min(Edges::Load(&fLeft  [node]));
+            fTop   [parents + i] = min(Edges::Load(&fTop   [node]));
+            fRight [parents + i] = max(Edges::Load(&fRight [node]));
+            fBottom[parents + i] = max(Edges::Load(&fBottom[node]));
+        }
+    }
+}
+
+void SkHilbertRTree::search(const SkRect& query, std::vector<int>* results) const {
+    if (fLevels.empty()) {
+        return;
+    }
+    const size_t firstResult = results->size();
+
+    struct Node {
+        int fLevel;
+        int fIndex;  // of the first entry in its level
+    };
+    // A node is only pushed once its parent is popped, so this never holds more than
+    // kNodeSize nodes per level.
+    Node stack[kNodeSize * kMaxDepth];
+    int depth = 0;
+    stack[depth++] = {SkToInt(fLevels.size()) - 1, 0};
+
+    while (depth > 0) {
+        const Node node = stack[--depth];
+        const int first = fLevels[node.fLevel] + node.fIndex;
+        // Touching is not intersecting, as in SkRect::Intersects().
+        auto hits = (Edges::Load(&fLeft  [first]) < query.fRight ) &
+                    (Edges::Load(&fTop   [first]) < query.fBottom) &
+                    (Edges::Load(&fRight [first]) > query.fLeft  ) &
+                    (Edges::Load(&fBottom[first]) > query.fTop   );
+        if (!any(hits)) {
+            continue;
+        }
+        for (int i = 0; i < kNodeSize; ++i) {
+            if (!hits[i]) {
+                continue;
+            }
+            if (node.fLevel == 0) {
+                results->push_back(fOpIndices[node.fIndex + i]);
+            } else {
+                stack[depth++] = {node.fLevel - 1, (node.fIndex + i) * kNodeSize};
+            }
+        }
+    }
+
+    // Hilbert order is not drawing order; callers play the results back in order.
+    std::sort(results->begin() + firstResult, results->end());
+}
+
+size_t SkHilbertRTree::bytesUsed() const {
+    return sizeof(*this)
+         + fLevels.capacity() * sizeof(int)
+         + (fLeft.capacity() + fTop.capacity() + fRight.capacity() + fBottom.capacity())
+                 * sizeof(float)
+         + fOpIndices.capacity() * sizeof(int)
+         + fLeaves.capacity() * sizeof(Leaf);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkHilbertRTree_DEFINED
+#define SkHilbertRTree_DEFINED
+
+#include "include/core/SkBBHFactory.h"
+#include "include/core/SkRect.h"
+#include "include/private/base/SkTo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A packed Hilbert R-Tree: a bulk-loaded R-Tree whose leaves are sorted by the position of
+ * their centers along a Hilbert curve, and then packed into full nodes of kNodeSize children.
+ *
+ * Unlike SkRTree, the nodes hold no pointers. Every level of the tree is stored contiguously,
+ * leaves first and the root last, and the bounds of its entries are kept as four separate arrays
+ * of edges. The children of the i-th entry of a level are the kNodeSize entries of the level
+ * below starting at i * kNodeSize, so a node is tested against a query with a single kNodeSize
+ * wide comparison of each edge. Levels are padded with empty bounds that never intersect.
+ *
+ * This suits pictures with very many ops (maps, for example) that are searched often.
+ *
+ * For more details see:
+ *
+ *  Kamel, I.; Faloutsos, C. (1993). "On packing R-trees"
+ */
+class SkHilbertRTree : public SkBBoxHierarchy {
+public:
+    SkHilbertRTree();
+
+    void insert(const SkRect[], int N) override;
+    void search(const SkRect& query, std::vector<int>* results) const override;
+    size_t bytesUsed() const override;
+
+    // Methods and constants below here are only public for tests.
+
+    // Return the depth of the tree structure.
+    int getDepth() const { return SkToInt(fLevels.size()); }
+    // Count of non-empty bounds inserted.
+    int getCount() const { return SkToInt(fOpIndices.size()); }
+
+    static constexpr int kNodeSize = 8;
+    // Enough levels for any int count of bounds.
+    static constexpr size_t kMaxDepth = 11;
+
+private:
+    struct Leaf {
+        uint32_t fDistance;
+        int fOpIndex;
+    };
+
+    // Index of the first entry of each level in the edge arrays, leaves first.
+    std::vector<int> fLevels;
+
+    std::vector<float> fLeft, fTop, fRight, fBottom;
+    // The op of each leaf.
+    std::vector<int> fOpIndices;
+
+    // Scratch for insert(), kept to insert again without allocating.
+    std::vector<Leaf> fLeaves;
+};
+
+#endif
@@ -7,7 +7,10 @@
 
 #include "include/core/SkPicture.h"
 
+#include "include/core/SkCanvas.h"
 #include "include/core/SkData.h"
+#include "include/core/SkMatrix.h"
+#include "include/core/SkPixmap.h"
 #include "include/core/SkPictureRecorder.h"
 #include "include/core/SkSerialProcs.h"
 #include "include/core/SkStream.h"
@@ -22,8 +25,11 @@
 #include "src/core/SkReadBuffer.h"
 #include "src/core/SkResourceCache.h"
 #include "src/core/SkStreamPriv.h"
+#include "src/core/SkTaskGroup.h"
 #include "src/core/SkWriteBuffer.h"
 
+#include "zlib.h"
+
 #include <atomic>
 #include <cstring>
 #include <memory>
@@ -38,8 +44,13 @@ enum {
     kFailure_TrailingStreamByteAfterPictInfo     = 0,   // nothing follows
     kPictureData_TrailingStreamByteAfterPictInfo = 1,   // SkPictureData follows
     kCustom_TrailingStreamByteAfterPictInfo      = 2,   // -size32 follows
+    kCompressed_TrailingStreamByteAfterPictInfo  = 3,   // size32, deflated size32, deflated
+                                                        // SkPictureData follow
 };
 
+// Deflate can't shrink data by more than this ratio; larger sizes are corrupt.
+static constexpr size_t kMaxDeflateRatio = 1032;
+
 /* SkPicture impl.  This handles generic responsibilities like unique IDs and serialization. */
 
 SkPicture::SkPicture() {
@@ -142,6 +153,36 @@ sk_sp<SkPicture> SkPicture::Forwardport(const SkPictInfo& info,
     return r.finishRecordingAsPicture();
 }
 
+void SkPicture::playbackTiled(const SkPixmap& dst, const SkMatrix& matrix, SkISize tileSize,
+                              SkExecutor& executor, const SkSurfaceProps* props) const {
+    if (!dst.addr() || dst.info().isEmpty()) {
+        return;
+    }
+    if (tileSize.isEmpty()) {
+        tileSize = dst.dimensions();
+    }
+    const int columns = (dst.width() + tileSize.width() - 1) / tileSize.width();
+    const int rows = (dst.height() + tileSize.height() - 1) / tileSize.height();
+
+    SkTaskGroup tasks(executor);
+    tasks.batch(columns * rows, [&](int i) {
+        // Tiles write disjoint pixels of dst, each through its own canvas
+        const SkIRect tile = SkIRect::MakeXYWH((i % columns) * tileSize.width(),
+                                               (i / columns) * tileSize.height(),
+                                               tileSize.width(),
+                                               tileSize.height());
+        std::unique_ptr<SkCanvas> canvas = SkCanvas::MakeRasterDirect(
+                dst.info(), dst.writable_addr(), dst.rowBytes(), props);
+        if (!canvas) {
+            return;
+        }
+        canvas->clipIRect(tile);
+        canvas->concat(matrix);
+        this->playback(canvas.get());
+    });
+    tasks.wait();
+}
+
 static const int kNestedSKPLimit = 100; // Arbitrarily set
 
 sk_sp<SkPicture> SkPicture::MakeFromStream(SkStream* stream, const SkDeserialProcs* procs) {
@@ -161,7 +202,8 @@ sk_sp<SkPicture> SkPicture::MakeFromData(const SkData* data, const SkDeserialPro
     if (!data) {
         return nullptr;
     }
-    SkMemoryStream stream(data->data(), data->size());
+    // The stream shares data, so that the picture can reference parts of it instead of copying
+    SkMemoryStream stream(SkData::MakeSubset(data, 0, data->size()));
     return MakeFromStreamPriv(&stream, procs, nullptr, kNestedSKPLimit);
 }
 
@@ -189,6 +231,33 @@ sk_sp<SkPicture> SkPicture::MakeFromStreamPriv(SkStream* stream, const SkDeseria
                                                     recursionLimit));
             return Forwardport(info, data.get(), nullptr);
         }
+        case kCompressed_TrailingStreamByteAfterPictInfo: {
+            uint32_t size, compressedSize;
+            if (!stream->readU32(&size) || !stream->readU32(&compressedSize) ||
+                compressedSize == 0 || size / kMaxDeflateRatio > compressedSize ||
+                StreamRemainingLengthIsBelow(stream, compressedSize)) {
+                return nullptr;
+            }
+            auto compressed = SkData::MakeUninitialized(compressedSize);
+            const size_t padding = SkAlign4(compressedSize) - compressedSize;
+            if (stream->read(compressed->writable_data(), compressedSize) != compressedSize ||
+                stream->skip(padding) != padding) {
+                return nullptr;
+            }
+            auto data = SkData::MakeUninitialized(size);
+            uLongf inflatedSize = size;
+            if (uncompress(static_cast<Bytef*>(data->writable_data()), &inflatedSize,
+                           compressed->bytes(), compressedSize) != Z_OK ||
+                inflatedSize != size) {
+                return nullptr;
+            }
+            // The picture reads its ops in place from the inflated data.
+            SkMemoryStream inflated(std::move(data));
+            std::unique_ptr<SkPictureData> pictureData(
+                    SkPictureData::CreateFromStream(&inflated, info, procs, typefaces,
+                                                    recursionLimit));
+            return Forwardport(info, pictureData.get(), nullptr);
+        }
         case kCustom_TrailingStreamByteAfterPictInfo: {
             int32_t ssize;
             if (!stream->readS32(&ssize) || ssize >= 0 || !procs.fPictureProc) {
@@ -277,6 +346,24 @@ static bool write_pad32(SkWStream* stream, const void* data, size_t size) {
     return true;
 }
 
+// Writes the trailing byte and raw deflated, or returns false having written nothing.
+static bool write_compressed(SkWStream* stream, const SkData* raw) {
+    if (!SkTFitsIn<uint32_t>(raw->size()) || !SkTFitsIn<uLong>(raw->size())) {
+        return false;
+    }
+    uLongf compressedSize = compressBound(raw->size());
+    auto compressed = SkData::MakeUninitialized(compressedSize);
+    if (compress2(static_cast<Bytef*>(compressed->writable_data()), &compressedSize,
+                  raw->bytes(), raw->size(), Z_BEST_COMPRESSION) != Z_OK ||
+        compressedSize >= raw->size()) {
+        return false;
+    }
+    stream->write8(kCompressed_TrailingStreamByteAfterPictInfo);
+    stream->write32(SkToU32(raw->size()));
+    stream->write32(SkToU32(compressedSize));
+    return write_pad32(stream, compressed->data(), compressedSize);
+}
+
 // Private serialize.
 // SkPictureData::serialize makes a first pass on all subpictures, indicated by textBlobsOnly=true,
 // to fill typefaceSet.
@@ -303,12 +390,26 @@ void SkPicture::serialize(SkWStream* stream, const SkSerialProcs* procsPtr,
     }
 
     std::unique_ptr<SkPictureData> data(this->backport());
-    if (data) {
-        stream->write8(kPictureData_TrailingStreamByteAfterPictInfo);
-        data->serialize(stream, procs, typefaceSet, textBlobsOnly);
-    } else {
+    if (!data) {
         stream->write8(kFailure_TrailingStreamByteAfterPictInfo);
+        return;
+    }
+    if (procs.fCompressPictures && !textBlobsOnly) {
+        // The sub-pictures are deflated along with this one, so they are written uncompressed.
+        SkSerialProcs nestedProcs = procs;
+        nestedProcs.fCompressPictures = false;
+        SkDynamicMemoryWStream uncompressed;
+        data->serialize(&uncompressed, nestedProcs, typefaceSet, textBlobsOnly);
+        sk_sp<SkData> raw = uncompressed.detachAsData();
+        if (write_compressed(stream, raw.get())) {
+            return;
+        }
+        stream->write8(kPictureData_TrailingStreamByteAfterPictInfo);
+        stream->write(raw->data(), raw->size());
+        return;
     }
+    stream->write8(kPictureData_TrailingStreamByteAfterPictInfo);
+    data->serialize(stream, procs, typefaceSet, textBlobsOnly);
 }
 
 void SkPicturePriv::Flatten(const sk_sp<const SkPicture> picture, SkWriteBuffer& buffer) {
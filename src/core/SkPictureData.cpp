@@ -303,6 +303,20 @@ void SkPictureData::flatten(SkWriteBuffer& buffer) const {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Returns the data of a memory stream, if it has one, so that the next size bytes of the stream
+// can be shared instead of copied.
+static sk_sp<SkData> stream_backing_data(SkStream* stream, size_t size) {
+    sk_sp<SkData> data = stream->getData();
+    if (!data || !stream->hasPosition() || stream->getMemoryBase() != data->data()) {
+        return nullptr;
+    }
+    const size_t position = stream->getPosition();
+    if (position > data->size() || size > data->size() - position) {
+        return nullptr;
+    }
+    return data;
+}
+
 bool SkPictureData::parseStreamTag(SkStream* stream,
                                    uint32_t tag,
                                    uint32_t size,
@@ -312,7 +326,17 @@ bool SkPictureData::parseStreamTag(SkStream* stream,
     switch (tag) {
         case SK_PICT_READER_TAG:
             SkASSERT(nullptr == fOpData);
-            fOpData = SkData::MakeFromStream(stream, size);
+            // SkPicturePlayback reads the ops in place, so they must be 4-byte aligned.
+            if (sk_sp<SkData> data = stream_backing_data(stream, size);
+                data && SkIsAlign4(reinterpret_cast<uintptr_t>(data->bytes() +
+                                                               stream->getPosition()))) {
+                fOpData = SkData::MakeSubset(data.get(), stream->getPosition(), size);
+                if (stream->skip(size) != size) {
+                    return false;
+                }
+            } else {
+                fOpData = SkData::MakeFromStream(stream, size);
+            }
             if (!fOpData) {
                 return false;
             }
@@ -381,12 +405,25 @@ bool SkPictureData::parseStreamTag(SkStream* stream,
             if (StreamRemainingLengthIsBelow(stream, size)) {
                 return false;
             }
-            SkAutoMalloc storage(size);
-            if (stream->read(storage.get(), size) != size) {
-                return false;
+            // Read the buffer in place when the stream is in memory (e.g. a mapped file),
+            // so that the images in it can share that memory.
+            SkReadBuffer buffer;
+            SkAutoMalloc storage;
+            sk_sp<SkData> data = stream_backing_data(stream, size);
+            const void* memory = data ? data->bytes() + stream->getPosition() : nullptr;
+            if (memory && SkIsAlign4(reinterpret_cast<uintptr_t>(memory))) {
+                buffer.setMemory(memory, size);
+                buffer.setBackingData(std::move(data));
+                if (stream->skip(size) != size) {
+                    return false;
+                }
+            } else {
+                storage.reset(size);
+                if (stream->read(storage.get(), size) != size) {
+                    return false;
+                }
+                buffer.setMemory(storage.get(), size);
             }
-
-            SkReadBuffer buffer(storage.get(), size);
             buffer.setVersion(fInfo.getVersion());
 
             if (!fFactoryPlayback) {
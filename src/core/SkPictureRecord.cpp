@@ -23,8 +23,10 @@
 #include "include/private/base/SkTo.h"
 #include "include/private/chromium/Slug.h"
 #include "src/core/SkCanvasPriv.h"
+#include "src/core/SkChecksum.h"
 #include "src/core/SkDrawShadowInfo.h"
 #include "src/core/SkMatrixPriv.h"
+#include "src/core/SkPathPriv.h"
 #include "src/core/SkSamplingPriv.h"
 #include "src/utils/SkPatchUtils.h"
 
@@ -871,10 +873,34 @@ void SkPictureRecord::addMatrix(const SkMatrix& matrix) {
     fWriter.writeMatrix(matrix);
 }
 
+uint32_t SkPictureRecord::PaintHash::operator()(const SkPaint& p) const {
+    // Effects are compared by pointer, as SkPaint's operator== does.
+    const void* effects[] = {p.getShader(), p.getColorFilter(), p.getPathEffect(),
+                             p.getMaskFilter(), p.getImageFilter(), p.getBlender()};
+    const SkColor4f color = p.getColor4f();
+    const SkScalar stroke[] = {p.getStrokeWidth(), p.getStrokeMiter()};
+    uint32_t hash = SkChecksum::Hash32(effects, sizeof(effects));
+    hash = SkChecksum::Hash32(&color, sizeof(color), hash);
+    return SkChecksum::Hash32(stroke, sizeof(stroke), hash);
+}
+
+uint32_t SkPictureRecord::PathHash::operator()(const SkPath& p) const {
+    uint32_t hash = SkChecksum::Hash32(SkPathPriv::VerbData(p), p.countVerbs());
+    hash = SkChecksum::Hash32(SkPathPriv::PointData(p), p.countPoints() * sizeof(SkPoint), hash);
+    hash = SkChecksum::Hash32(SkPathPriv::ConicWeightData(p),
+                              SkPathPriv::ConicWeightCnt(p) * sizeof(SkScalar), hash);
+    return hash ^ static_cast<uint32_t>(p.getFillType());
+}
+
 void SkPictureRecord::addPaintPtr(const SkPaint* paint) {
     if (paint) {
-        fPaints.push_back(*paint);
-        this->addInt(fPaints.size());
+        // convention for paints is 1-based index
+        int* n = fPaintIndices.find(*paint);
+        if (!n) {
+            fPaints.push_back(*paint);
+            n = fPaintIndices.set(*paint, fPaints.size());
+        }
+        this->addInt(*n);
     } else {
         this->addInt(0);
     }
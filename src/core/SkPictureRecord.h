@@ -272,8 +272,14 @@ protected:
 private:
     skia_private::TArray<SkPaint>  fPaints;
 
+    // Equal paints and paths are stored once, however they were made.
+    struct PaintHash {
+        uint32_t operator()(const SkPaint& p) const;
+    };
+    skia_private::THashMap<SkPaint, int, PaintHash> fPaintIndices;
+
     struct PathHash {
-        uint32_t operator()(const SkPath& p) { return p.getGenerationID(); }
+        uint32_t operator()(const SkPath& p) const;
     };
     skia_private::THashMap<SkPath, int, PathHash> fPaths;
 
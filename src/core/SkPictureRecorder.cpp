@@ -27,6 +27,7 @@ using namespace skia_private;
 
 SkPictureRecorder::SkPictureRecorder() {
     fActivelyRecording = false;
+    fRecycling = false;
     fRecorder = std::make_unique<SkRecordCanvas>(nullptr, SkRect::MakeEmpty());
 }
 
@@ -40,7 +41,7 @@ SkCanvas* SkPictureRecorder::beginRecording(const SkRect& userCullRect,
     fBBH = std::move(bbh);
 
     if (!fRecord) {
-        fRecord.reset(new SkRecord);
+        fRecord = this->makeRecord();
     }
     fRecorder->reset(fRecord.get(), cullRect);
     fActivelyRecording = true;
@@ -51,6 +52,37 @@ SkCanvas* SkPictureRecorder::beginRecording(const SkRect& bounds, SkBBHFactory*
     return this->beginRecording(bounds, factory ? (*factory)() : nullptr);
 }
 
+sk_sp<SkRecord> SkPictureRecorder::makeRecord() {
+    if (!fRecycling) {
+        return sk_make_sp<SkRecord>();
+    }
+    // A record only the recorder refers to belongs to a picture that was deleted.
+    sk_sp<SkRecord>* empty = nullptr;
+    for (sk_sp<SkRecord>& record : fRecycledRecords) {
+        if (record && record->unique()) {
+            record->reset();
+            return record;
+        }
+        if (!record && !empty) {
+            empty = &record;
+        }
+    }
+    auto record = sk_make_sp<SkRecord>();
+    if (empty) {
+        *empty = record;
+    }
+    return record;
+}
+
+void SkPictureRecorder::setRecycling(bool recycling) {
+    fRecycling = recycling;
+    if (!recycling) {
+        for (sk_sp<SkRecord>& record : fRecycledRecords) {
+            record.reset();
+        }
+    }
+}
+
 SkCanvas* SkPictureRecorder::getRecordingCanvas() {
     return fActivelyRecording ? fRecorder.get() : nullptr;
 }
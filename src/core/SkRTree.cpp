@@ -13,9 +13,11 @@
 SkRTree::SkRTree() : fCount(0) {}
 
 void SkRTree::insert(const SkRect boundsArray[], int N) {
-    SkASSERT(0 == fCount);
-
-    std::vector<Branch> branches;
+    // Start over, keeping the memory of the last insert().
+    fCount = 0;
+    fNodes.clear();
+    std::vector<Branch>& branches = fBranches;
+    branches.clear();
     branches.reserve(N);
 
     for (int i = 0; i < N; i++) {
@@ -166,6 +168,7 @@ size_t SkRTree::bytesUsed() const {
     size_t byteCount = sizeof(SkRTree);
 
     byteCount += fNodes.capacity() * sizeof(Node);
+    byteCount += fBranches.capacity() * sizeof(Branch);
 
     return byteCount;
 }
@@ -320,6 +320,18 @@ sk_sp<SkData> SkReadBuffer::readByteArrayAsData() {
         return nullptr;
     }
 
+    if (fBackingData) {
+        (void)this->readUInt();
+        const void* bytes = this->skip(numBytes);
+        if (!bytes) {
+            return nullptr;
+        }
+        return SkData::MakeSubset(fBackingData.get(),
+                                  static_cast<const char*>(bytes) -
+                                          static_cast<const char*>(fBackingData->data()),
+                                  numBytes);
+    }
+
     SkAutoMalloc buffer(numBytes);
     if (!this->readByteArray(buffer.get(), numBytes)) {
         return nullptr;
@@ -10,6 +10,7 @@
 
 #include "include/core/SkColor.h"
 #include "include/core/SkColorFilter.h"
+#include "include/core/SkData.h"
 #include "include/core/SkFlattenable.h"
 #include "include/core/SkImageFilter.h"
 #include "include/core/SkPaint.h"
@@ -36,6 +37,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <utility>
 
 class SkBlender;
 class SkData;
@@ -59,6 +61,13 @@ public:
 
     void setMemory(const void*, size_t);
 
+    /**
+     *  Declares that the memory given to setMemory() lies within data. Byte arrays read with
+     *  readByteArrayAsData() (and so the encoded images) then share data instead of being copied,
+     *  which keeps them in place when data is memory mapped.
+     */
+    void setBackingData(sk_sp<SkData> data) { fBackingData = std::move(data); }
+
     /**
      *  Returns true IFF the version is older than the specified version.
      */
@@ -237,6 +246,7 @@ private:
     const char* fCurr = nullptr;  // current position within buffer
     const char* fStop = nullptr;  // end of buffer
     const char* fBase = nullptr;  // beginning of buffer
+    sk_sp<SkData> fBackingData;   // contains [fBase, fStop) when not null
 
     // Only used if we do not have an fFactoryArray.
     skia_private::THashMap<uint32_t, SkFlattenable::Factory> fFlattenableDict;
@@ -7,13 +7,18 @@
 
 #include "src/core/SkRecord.h"
 
+#include "include/private/base/SkASAN.h"
+
 #include <algorithm>
+#include <new>
 
 SkRecord::~SkRecord() {
     Destroyer destroyer;
     for (int i = 0; i < this->count(); i++) {
         this->mutate(i, destroyer);
     }
+    // fAlloc may have poisoned the unused end of the block.
+    sk_asan_unpoison_memory_region(fBlock.get(), fBlockSize);
 }
 
 void SkRecord::grow() {
@@ -35,3 +40,23 @@ void SkRecord::defrag() {
                                    [](Record op) { return op.type() == SkRecords::NoOp_Type; });
     fCount = noops - fRecords.get();
 }
+
+void SkRecord::reset() {
+    Destroyer destroyer;
+    for (int i = 0; i < this->count(); i++) {
+        this->mutate(i, destroyer);
+    }
+    fCount = 0;
+
+    // Every command was allocated as plain bytes, so fApproxBytesAllocated bounds what the
+    // arena used. Leave some room for the next recording to grow before it spills.
+    const size_t needed = fApproxBytesAllocated + fApproxBytesAllocated / 4 + 64;
+    fAlloc.~SkArenaAlloc();
+    sk_asan_unpoison_memory_region(fBlock.get(), fBlockSize);
+    if (needed > fBlockSize && fApproxBytesAllocated > 0) {
+        fBlockSize = needed;
+        fBlock.reset(fBlockSize);
+    }
+    new (&fAlloc) SkArenaAlloc(fBlock.get(), fBlockSize, kFirstHeapAllocation);
+    fApproxBytesAllocated = 0;
+}
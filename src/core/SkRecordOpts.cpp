@@ -12,8 +12,10 @@
 #include "include/core/SkColor.h"
 #include "include/core/SkPaint.h"
 #include "include/core/SkRefCnt.h"
+#include "include/core/SkShader.h"
 #include "include/private/base/SkMath.h"
 #include "include/private/base/SkTemplates.h"
+#include "src/base/SkTime.h"
 #include "src/core/SkRecord.h"
 #include "src/core/SkRecordPattern.h"
 #include "src/core/SkRecords.h"
@@ -266,23 +268,219 @@ void SkRecordMergeSvgOpacityAndFilterLayers(SkRecord* record) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+using IsMatrix = Or<Is<SetMatrix>, Is<SetM44>, Is<Translate>, Is<Scale>, Is<Concat>, Is<Concat44>>;
+
+// Turns a matrix change into a NoOp when the matrix is replaced before anything uses it.
+struct DeadMatrixNooper {
+    typedef Pattern<IsMatrix,
+                    Greedy<Is<NoOp>>,
+                    Or<Is<SetMatrix>, Is<SetM44>, Is<Restore>>>
+        Match;
+
+    bool onMatch(SkRecord* record, Match*, int begin, int end) {
+        record->replace<NoOp>(begin);
+        return true;
+    }
+};
+
+// Folds Translate-Translate into the second Translate.
+struct TranslateMerger {
+    typedef Pattern<Is<Translate>, Greedy<Is<NoOp>>, Is<Translate>> Match;
+
+    bool onMatch(SkRecord* record, Match* match, int begin, int end) {
+        Translate* second = match->third<Translate>();
+        second->dx += match->first<Translate>()->dx;
+        second->dy += match->first<Translate>()->dy;
+        record->replace<NoOp>(begin);
+        return true;
+    }
+};
+
+// Folds Scale-Scale into the second Scale.
+struct ScaleMerger {
+    typedef Pattern<Is<Scale>, Greedy<Is<NoOp>>, Is<Scale>> Match;
+
+    bool onMatch(SkRecord* record, Match* match, int begin, int end) {
+        Scale* second = match->third<Scale>();
+        second->sx *= match->first<Scale>()->sx;
+        second->sy *= match->first<Scale>()->sy;
+        record->replace<NoOp>(begin);
+        return true;
+    }
+};
+
+void SkRecordCollapseMatrices(SkRecord* record) {
+    DeadMatrixNooper dead;
+    TranslateMerger translates;
+    ScaleMerger scales;
+
+    // Each match can make another one, so run until they stop changing things.
+    while (apply(&dead, record) || apply(&translates, record) || apply(&scales, record));
+}
+
+// Turns the second aliased ClipRect in ClipRect-Draw*-ClipRect into a NoOp if it can't change the
+// clip.
+struct RedundantClipRectNooper {
+    typedef Pattern<Is<ClipRect>,
+                    Greedy<Or<Is<NoOp>, IsDraw>>,
+                    Is<ClipRect>>
+        Match;
+
+    bool onMatch(SkRecord* record, Match* match, int begin, int end) {
+        const ClipRect* first = match->first<ClipRect>();
+        const ClipRect* second = match->third<ClipRect>();
+        // Antialiased rect clips multiply their coverage on raster, so repeating a fractional one
+        // changes the clip. Only aliased ones are safe to drop.
+        if (first->opAA.op() != second->opAA.op() || first->opAA.aa() || second->opAA.aa()) {
+            return false;
+        }
+        // Intersecting with a rect that holds the last one leaves the clip as it is, and
+        // subtracting the same rect again does nothing either.
+        if (first->opAA.op() == SkClipOp::kIntersect ? !second->rect.contains(first->rect)
+                                                      : second->rect != first->rect) {
+            return false;
+        }
+        record->replace<NoOp>(end-1);
+        return true;
+    }
+};
+
+void SkRecordNoopRedundantClips(SkRecord* record) {
+    RedundantClipRectNooper pass;
+    while (apply(&pass, record));
+}
+
+static bool is_opaque_fill(const SkPaint& paint) {
+    return paint.getAlpha() == 0xFF &&
+           (!paint.getShader() || paint.getShader()->isOpaque()) &&
+           !paint.getColorFilter() &&
+           !paint.getMaskFilter() &&
+           !paint.getImageFilter() &&
+           (paint.isSrcOver() || paint.asBlendMode() == SkBlendMode::kSrc);
+}
+
+// Not a pattern: an opaque DrawPaint hides every draw since the last change of the clip or layer,
+// however many there are.
+struct OccludedDrawNooper {
+    enum Kind {
+        kBarrier,   // Changes the clip or layer; draws before it can't be hidden by draws after.
+        kNeutral,   // Leaves the pixels alone, or must be kept anyway.
+        kDraw,      // Can be hidden.
+        kOccluder,  // Hides the draws before it.
+    };
+
+    bool fSoftClip = false;
+
+    template <typename T>
+    Kind operator()(T*) {
+        if constexpr ((T::kTags & kDraw_Tag) != 0) {
+            return kDraw;
+        } else {
+            return kBarrier;
+        }
+    }
+
+    Kind operator()(NoOp*)           { return kNeutral; }
+    Kind operator()(SetMatrix*)      { return kNeutral; }
+    Kind operator()(SetM44*)         { return kNeutral; }
+    Kind operator()(Translate*)      { return kNeutral; }
+    Kind operator()(Scale*)          { return kNeutral; }
+    Kind operator()(Concat*)         { return kNeutral; }
+    Kind operator()(Concat44*)       { return kNeutral; }
+    Kind operator()(DrawAnnotation*) { return kNeutral; }
+    // These may hold annotations, which must survive.
+    Kind operator()(DrawPicture*)    { return kNeutral; }
+    Kind operator()(DrawDrawable*)   { return kNeutral; }
+    Kind operator()(DrawBehind*)     { return kBarrier; }
+
+    Kind operator()(ClipRect* op)   { fSoftClip |= op->opAA.aa(); return kBarrier; }
+    Kind operator()(ClipRRect* op)  { fSoftClip |= op->opAA.aa(); return kBarrier; }
+    Kind operator()(ClipPath* op)   { fSoftClip |= op->opAA.aa(); return kBarrier; }
+    Kind operator()(ClipShader*)    { fSoftClip = true;           return kBarrier; }
+
+    Kind operator()(DrawPaint* op) {
+        return !fSoftClip && is_opaque_fill(op->paint) ? kOccluder : kDraw;
+    }
+};
+
+void SkRecordNoopOccludedDraws(SkRecord* record) {
+    OccludedDrawNooper kind;
+    int segmentStart = 0;
+    for (int i = 0; i < record->count(); i++) {
+        switch (record->mutate(i, kind)) {
+            case OccludedDrawNooper::kBarrier:
+                segmentStart = i + 1;
+                break;
+            case OccludedDrawNooper::kOccluder:
+                for (int j = segmentStart; j < i; j++) {
+                    // Classifying again can't change fSoftClip: only clips set it.
+                    auto k = record->mutate(j, kind);
+                    if (k == OccludedDrawNooper::kDraw || k == OccludedDrawNooper::kOccluder) {
+                        record->replace<NoOp>(j);
+                    }
+                }
+                segmentStart = i + 1;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int count_noops(SkRecord* record) {
+    int count = 0;
+    Is<NoOp> isNoOp;
+    for (int i = 0; i < record->count(); i++) {
+        count += record->mutate(i, isNoOp) ? 1 : 0;
+    }
+    return count;
+}
+
 void SkRecordOptimize(SkRecord* record) {
-    // This might be useful  as a first pass in the future if we want to weed
-    // out junk for other optimization passes.  Right now, nothing needs it,
-    // and the bounding box hierarchy will do the work of skipping no-op
-    // Save-NoDraw-Restore sequences better than we can here.
-    // As there is a known problem with this peephole and drawAnnotation, disable this.
-    // If we want to enable this we must first fix this bug:
-    //     https://bugs.chromium.org/p/skia/issues/detail?id=5548
-//    SkRecordNoopSaveRestores(record);
+    SkRecordOptimize(record, kDefault_SkRecordOptimizations);
+}
 
-    // Turn off this optimization completely for Android framework
+void SkRecordOptimize(SkRecord* record, uint32_t optimizations, SkRecordOptimizeStats* stats) {
+    // SkRecordNoopSaveRestores is not in the defaults: it might be useful as a first pass in the
+    // future if we want to weed out junk for other optimization passes.  Right now, nothing needs
+    // it, and the bounding box hierarchy will do the work of skipping no-op Save-NoDraw-Restore
+    // sequences better than we can here.
+    // As there is a known problem with this peephole and drawAnnotation, it must not be enabled
+    // by default until this bug is fixed:
+    //     https://bugs.chromium.org/p/skia/issues/detail?id=5548
+    //
+    // SkRecordNoopSaveLayerDrawRestores is off completely for Android framework
     // because it makes the following Android CTS test fail:
     // android.uirendering.cts.testclasses.LayerTests#testSaveLayerClippedWithAlpha
+    static void (*const kPasses[kSkRecordOptimizationCount])(SkRecord*) = {
+        SkRecordNoopSaveRestores,
 #ifndef SK_BUILD_FOR_ANDROID_FRAMEWORK
-    SkRecordNoopSaveLayerDrawRestores(record);
+        SkRecordNoopSaveLayerDrawRestores,
+#else
+        nullptr,
 #endif
-    SkRecordMergeSvgOpacityAndFilterLayers(record);
+        SkRecordMergeSvgOpacityAndFilterLayers,
+        SkRecordCollapseMatrices,
+        SkRecordNoopRedundantClips,
+        SkRecordNoopOccludedDraws,
+    };
+
+    for (int i = 0; i < kSkRecordOptimizationCount; i++) {
+        if (!(optimizations & (1u << i)) || !kPasses[i]) {
+            continue;
+        }
+        if (!stats) {
+            kPasses[i](record);
+            continue;
+        }
+        const int noops = count_noops(record);
+        const double start = SkTime::GetNSecs();
+        kPasses[i](record);
+        stats->fNanos[i] += SkTime::GetNSecs() - start;
+        stats->fNoopedOps[i] += count_noops(record) - noops;
+    }
 
     record->defrag();
 }
@@ -114,6 +114,23 @@ SkStrike::FlattenGlyphsByType(SkWriteBuffer& buffer,
     }
 }
 
+void SkStrike::flattenGlyphs(SkWriteBuffer& buffer) {
+    std::vector<SkGlyph> images, paths, drawables;
+    Monitor m{this};
+    for (SkGlyph* glyph : fGlyphForIndex) {
+        if (glyph->setImageHasBeenCalled()) {
+            images.push_back(*glyph);
+        }
+        if (glyph->setPathHasBeenCalled()) {
+            paths.push_back(*glyph);
+        }
+        if (glyph->setDrawableHasBeenCalled()) {
+            drawables.push_back(*glyph);
+        }
+    }
+    FlattenGlyphsByType(buffer, images, paths, drawables);
+}
+
 bool SkStrike::mergeFromBuffer(SkReadBuffer& buffer) {
     // Read glyphs with images for the current strike.
     const int imagesCount = buffer.readInt();
@@ -240,6 +257,18 @@ SkSpan<const SkGlyph*> SkStrike::prepareImages(
     return {results, glyphIDs.size()};
 }
 
+void SkStrike::prerasterize(SkSpan<const SkPackedGlyphID> glyphIDs, ActionType actionType) {
+    Monitor m{this};
+    for (SkPackedGlyphID glyphID : glyphIDs) {
+        // Deciding the path, drawable and CPU mask actions already generates what they draw.
+        SkGlyphDigest digest = this->digestFor(actionType, glyphID);
+        if (digest.actionFor(actionType) == GlyphAction::kAccept &&
+            (actionType == kDirectMask || actionType == kMask || actionType == kSDFT)) {
+            this->prepareForImage(this->glyph(digest));
+        }
+    }
+}
+
 SkSpan<const SkGlyph*> SkStrike::prepareDrawables(
         SkSpan<const SkGlyphID> glyphIDs, const SkGlyph* results[]) {
     const SkGlyph** cursor = results;
@@ -445,11 +474,13 @@ SkSpan<const SkGlyph*> SkStrike::internalPrepare(
 
 void SkStrike::updateMemoryUsage(size_t increase) {
     if (increase > 0) {
-        // fRemoved and the cache's total memory are managed under the cache's lock. This allows
+        // fRemoved and the shard's memory are managed under the shard's lock. This allows
         // them to be accessed under LRU operation.
-        SkAutoMutexExclusive lock{fStrikeCache->fLock};
+        SkStrikeCache::Shard& shard = fStrikeCache->shardFor(fStrikeSpec.descriptor());
+        SkAutoMutexExclusive lock{shard.fLock};
         fMemoryUsed += increase;
         if (!fRemoved) {
+            shard.fMemoryUsed += increase;
             fStrikeCache->fTotalMemoryUsed += increase;
         }
     }
@@ -15,10 +15,13 @@
 #include "include/private/base/SkMutex.h"
 #include "src/core/SkDescriptor.h"
 #include "src/core/SkStrike.h"
+#include "src/core/SkStrikeDiskCache.h"
 #include "src/core/SkStrikeSpec.h"
+#include "src/core/SkTaskGroup.h"
 
 #include <algorithm>
 #include <utility>
+#include <vector>
 
 class SkScalerContext;
 struct SkFontMetrics;
@@ -36,20 +39,102 @@ SkStrikeCache* SkStrikeCache::GlobalStrikeCache() {
     return cache;
 }
 
+SkStrikeCache::SkStrikeCache() = default;
+
+SkStrikeCache::~SkStrikeCache() = default;
+
 auto SkStrikeCache::findOrCreateStrike(const SkStrikeSpec& strikeSpec) -> sk_sp<SkStrike> {
-    SkAutoMutexExclusive ac(fLock);
-    sk_sp<SkStrike> strike = this->internalFindStrikeOrNull(strikeSpec.descriptor());
+    Shard& shard = this->shardFor(strikeSpec.descriptor());
+    sk_sp<SkStrike> strike;
+    {
+        SkAutoMutexExclusive ac(shard.fLock);
+        strike = this->internalFindStrikeOrNull(shard, strikeSpec.descriptor());
+        if (strike == nullptr && !fUsesDiskCache.load(std::memory_order_relaxed)) {
+            strike = this->internalCreateStrike(shard, strikeSpec);
+        }
+    }
     if (strike == nullptr) {
-        strike = this->internalCreateStrike(strikeSpec);
+        strike = this->createStrikeFromDiskCache(shard, strikeSpec);
     }
-    this->internalPurge();
+    this->purge(0, false, strike.get());
     return strike;
 }
 
+auto SkStrikeCache::createStrikeFromDiskCache(Shard& shard, const SkStrikeSpec& strikeSpec)
+        -> sk_sp<SkStrike> {
+    // Merging the stored glyphs updates the strike's memory use under the shard's lock, so it is
+    // done before the strike is added. Marking it removed until then keeps that memory from being
+    // counted twice.
+    std::unique_ptr<SkScalerContext> scaler = strikeSpec.createScalerContext();
+    auto strike = sk_make_sp<SkStrike>(this, strikeSpec, std::move(scaler), nullptr, nullptr);
+    strike->fRemoved = true;
+    // The disk cache may have been removed since the caller checked; then nothing is loaded.
+    if (sk_sp<SkStrikeDiskCache> diskCache = this->diskCache()) {
+        diskCache->load(strike.get());
+    }
+
+    SkAutoMutexExclusive ac(shard.fLock);
+    if (sk_sp<SkStrike> existing = this->internalFindStrikeOrNull(shard, strikeSpec.descriptor())) {
+        return existing;
+    }
+    strike->fRemoved = false;
+    this->internalAttachToHead(shard, strike);
+    return strike;
+}
+
+void SkStrikeCache::setDiskCache(sk_sp<SkStrikeDiskCache> diskCache) {
+    // The previous disk cache is released after unlocking, once no other thread uses it.
+    SkAutoMutexExclusive ac(fDiskCacheLock);
+    std::swap(fDiskCache, diskCache);
+    fUsesDiskCache.store(fDiskCache != nullptr, std::memory_order_relaxed);
+}
+
+sk_sp<SkStrikeDiskCache> SkStrikeCache::diskCache() const {
+    SkAutoMutexExclusive ac(fDiskCacheLock);
+    return fDiskCache;
+}
+
+int SkStrikeCache::storeToDiskCache() {
+    sk_sp<SkStrikeDiskCache> diskCache = this->diskCache();
+    if (diskCache == nullptr) {
+        return 0;
+    }
+
+    int stored = 0;
+    for (Shard& shard : fShards) {
+        // Storing locks each strike, and unlocking a strike takes the shard's lock.
+        std::vector<sk_sp<SkStrike>> strikes;
+        {
+            SkAutoMutexExclusive ac(shard.fLock);
+            for (SkStrike* strike = shard.fHead; strike != nullptr; strike = strike->fNext) {
+                strikes.push_back(sk_ref_sp(strike));
+            }
+        }
+        for (const sk_sp<SkStrike>& strike : strikes) {
+            stored += diskCache->store(strike.get()) ? 1 : 0;
+        }
+    }
+    return stored;
+}
+
 sk_sp<StrikeForGPU> SkStrikeCache::findOrCreateScopedStrike(const SkStrikeSpec& strikeSpec) {
     return this->findOrCreateStrike(strikeSpec);
 }
 
+void SkStrikeCache::prerasterize(SkSpan<const GlyphBatch> batches, SkExecutor& executor) {
+    SkTaskGroup tasks(executor);
+    for (const GlyphBatch& batch : batches) {
+        if (batch.fStrikeSpec == nullptr || batch.fGlyphIDs.empty()) {
+            continue;
+        }
+        tasks.add([this, &batch] {
+            sk_sp<SkStrike> strike = this->findOrCreateStrike(*batch.fStrikeSpec);
+            strike->prerasterize(batch.fGlyphIDs, batch.fAction);
+        });
+    }
+    tasks.wait();
+}
+
 void SkStrikeCache::PurgeAll() {
     GlobalStrikeCache()->purgeAll();
 }
@@ -89,35 +174,49 @@ void SkStrikeCache::DumpMemoryStatistics(SkTraceMemoryDump* dump) {
     GlobalStrikeCache()->forEachStrike(visitor);
 }
 
+auto SkStrikeCache::shardFor(const SkDescriptor& desc) -> Shard& {
+    // The lookup tables index with the low bits of the checksum, so pick shards with the high ones.
+    return fShards[desc.getChecksum() >> (32 - kShardBits)];
+}
+
 sk_sp<SkStrike> SkStrikeCache::findStrike(const SkDescriptor& desc) {
-    SkAutoMutexExclusive ac(fLock);
-    sk_sp<SkStrike> result = this->internalFindStrikeOrNull(desc);
-    this->internalPurge();
+    Shard& shard = this->shardFor(desc);
+    sk_sp<SkStrike> result;
+    {
+        SkAutoMutexExclusive ac(shard.fLock);
+        result = this->internalFindStrikeOrNull(shard, desc);
+    }
+    this->purge(0, false, result.get());
     return result;
 }
 
-auto SkStrikeCache::internalFindStrikeOrNull(const SkDescriptor& desc) -> sk_sp<SkStrike> {
+auto SkStrikeCache::internalFindStrikeOrNull(Shard& shard, const SkDescriptor& desc)
+        -> sk_sp<SkStrike> {
 
     // Check head because it is likely the strike we are looking for.
-    if (fHead != nullptr && fHead->getDescriptor() == desc) { return sk_ref_sp(fHead); }
+    if (shard.fHead != nullptr && shard.fHead->getDescriptor() == desc) {
+        shard.fHead->fLastUse = fUseClock.fetch_add(1, std::memory_order_relaxed);
+        return sk_ref_sp(shard.fHead);
+    }
 
     // Do the heavy search looking for the strike.
-    sk_sp<SkStrike>* strikeHandle = fStrikeLookup.find(desc);
+    sk_sp<SkStrike>* strikeHandle = shard.fStrikeLookup.find(desc);
     if (strikeHandle == nullptr) { return nullptr; }
     SkStrike* strikePtr = strikeHandle->get();
     SkASSERT(strikePtr != nullptr);
-    if (fHead != strikePtr) {
+    strikePtr->fLastUse = fUseClock.fetch_add(1, std::memory_order_relaxed);
+    if (shard.fHead != strikePtr) {
         // Make most recently used
         strikePtr->fPrev->fNext = strikePtr->fNext;
         if (strikePtr->fNext != nullptr) {
             strikePtr->fNext->fPrev = strikePtr->fPrev;
         } else {
-            fTail = strikePtr->fPrev;
+            shard.fTail = strikePtr->fPrev;
         }
-        fHead->fPrev = strikePtr;
-        strikePtr->fNext = fHead;
+        shard.fHead->fPrev = strikePtr;
+        strikePtr->fNext = shard.fHead;
         strikePtr->fPrev = nullptr;
-        fHead = strikePtr;
+        shard.fHead = strikePtr;
     }
     return sk_ref_sp(strikePtr);
 }
@@ -126,58 +225,51 @@ sk_sp<SkStrike> SkStrikeCache::createStrike(
         const SkStrikeSpec& strikeSpec,
         SkFontMetrics* maybeMetrics,
         std::unique_ptr<SkStrikePinner> pinner) {
-    SkAutoMutexExclusive ac(fLock);
-    return this->internalCreateStrike(strikeSpec, maybeMetrics, std::move(pinner));
+    Shard& shard = this->shardFor(strikeSpec.descriptor());
+    SkAutoMutexExclusive ac(shard.fLock);
+    return this->internalCreateStrike(shard, strikeSpec, maybeMetrics, std::move(pinner));
 }
 
 auto SkStrikeCache::internalCreateStrike(
+        Shard& shard,
         const SkStrikeSpec& strikeSpec,
         SkFontMetrics* maybeMetrics,
         std::unique_ptr<SkStrikePinner> pinner) -> sk_sp<SkStrike> {
     std::unique_ptr<SkScalerContext> scaler = strikeSpec.createScalerContext();
     auto strike =
         sk_make_sp<SkStrike>(this, strikeSpec, std::move(scaler), maybeMetrics, std::move(pinner));
-    this->internalAttachToHead(strike);
+    this->internalAttachToHead(shard, strike);
     return strike;
 }
 
 void SkStrikeCache::purgePinned(size_t minBytesNeeded) {
-    SkAutoMutexExclusive ac(fLock);
-    this->internalPurge(minBytesNeeded, /* checkPinners= */ true);
+    this->purge(minBytesNeeded, /* checkPinners= */ true);
 }
 
 void SkStrikeCache::purgeAll() {
-    SkAutoMutexExclusive ac(fLock);
-    this->internalPurge(fTotalMemoryUsed, /* checkPinners= */ true);
+    this->purge(fTotalMemoryUsed.load(), /* checkPinners= */ true);
 }
 
 size_t SkStrikeCache::getTotalMemoryUsed() const {
-    SkAutoMutexExclusive ac(fLock);
-    return fTotalMemoryUsed;
+    return fTotalMemoryUsed.load(std::memory_order_relaxed);
 }
 
 int SkStrikeCache::getCacheCountUsed() const {
-    SkAutoMutexExclusive ac(fLock);
-    return fCacheCount;
+    return fCacheCount.load(std::memory_order_relaxed);
 }
 
 int SkStrikeCache::getCacheCountLimit() const {
-    SkAutoMutexExclusive ac(fLock);
-    return fCacheCountLimit;
+    return fCacheCountLimit.load(std::memory_order_relaxed);
 }
 
 size_t SkStrikeCache::setCacheSizeLimit(size_t newLimit) {
-    SkAutoMutexExclusive ac(fLock);
-
-    size_t prevLimit = fCacheSizeLimit;
-    fCacheSizeLimit = newLimit;
-    this->internalPurge();
+    size_t prevLimit = fCacheSizeLimit.exchange(newLimit);
+    this->purge();
     return prevLimit;
 }
 
 size_t  SkStrikeCache::getCacheSizeLimit() const {
-    SkAutoMutexExclusive ac(fLock);
-    return fCacheSizeLimit;
+    return fCacheSizeLimit.load(std::memory_order_relaxed);
 }
 
 int SkStrikeCache::setCacheCountLimit(int newCount) {
@@ -185,48 +277,53 @@ int SkStrikeCache::setCacheCountLimit(int newCount) {
         newCount = 0;
     }
 
-    SkAutoMutexExclusive ac(fLock);
-
-    int prevCount = fCacheCountLimit;
-    fCacheCountLimit = newCount;
-    this->internalPurge();
+    int prevCount = fCacheCountLimit.exchange(newCount);
+    this->purge();
     return prevCount;
 }
 
 void SkStrikeCache::forEachStrike(std::function<void(const SkStrike&)> visitor) const {
-    SkAutoMutexExclusive ac(fLock);
+    for (const Shard& shard : fShards) {
+        SkAutoMutexExclusive ac(shard.fLock);
 
-    this->validate();
+        SkDEBUGCODE(this->validate(shard);)
 
-    for (SkStrike* strike = fHead; strike != nullptr; strike = strike->fNext) {
-        visitor(*strike);
+        for (SkStrike* strike = shard.fHead; strike != nullptr; strike = strike->fNext) {
+            visitor(*strike);
+        }
     }
 }
 
-size_t SkStrikeCache::internalPurge(size_t minBytesNeeded, bool checkPinners) {
+size_t SkStrikeCache::purge(size_t minBytesNeeded, bool checkPinners, const SkStrike* keep) {
 #ifndef SK_STRIKE_CACHE_DOESNT_AUTO_CHECK_PINNERS
     // Temporarily default to checking pinners, for staging.
     checkPinners = true;
 #endif
 
-    if (fPinnerCount == fCacheCount && !checkPinners)
+    // The totals are read without any shard lock held, so this is a snapshot; a strike added
+    // concurrently is accounted for by the purge that follows its own insertion.
+    const size_t totalMemoryUsed = fTotalMemoryUsed.load();
+    const int32_t cacheCount = fCacheCount.load();
+    if (fPinnerCount.load() == cacheCount && !checkPinners)
         return 0;
 
     size_t bytesNeeded = 0;
-    if (fTotalMemoryUsed > fCacheSizeLimit) {
-        bytesNeeded = fTotalMemoryUsed - fCacheSizeLimit;
+    const size_t cacheSizeLimit = fCacheSizeLimit.load(std::memory_order_relaxed);
+    if (totalMemoryUsed > cacheSizeLimit) {
+        bytesNeeded = totalMemoryUsed - cacheSizeLimit;
     }
     bytesNeeded = std::max(bytesNeeded, minBytesNeeded);
     if (bytesNeeded) {
         // no small purges!
-        bytesNeeded = std::max(bytesNeeded, fTotalMemoryUsed >> 2);
+        bytesNeeded = std::max(bytesNeeded, totalMemoryUsed >> 2);
     }
 
     int countNeeded = 0;
-    if (fCacheCount > fCacheCountLimit) {
-        countNeeded = fCacheCount - fCacheCountLimit;
+    const int32_t cacheCountLimit = fCacheCountLimit.load(std::memory_order_relaxed);
+    if (cacheCount > cacheCountLimit) {
+        countNeeded = cacheCount - cacheCountLimit;
         // no small purges!
-        countNeeded = std::max(countNeeded, fCacheCount >> 2);
+        countNeeded = std::max(countNeeded, cacheCount >> 2);
     }
 
     // early exit
@@ -234,26 +331,50 @@ size_t SkStrikeCache::internalPurge(size_t minBytesNeeded, bool checkPinners) {
         return 0;
     }
 
+    // Each shard's list is in LRU order, so the least recently used strikes of the whole cache
+    // are among the shard tails that would meet the budget on their own. Pick those, one shard
+    // lock at a time, and remove the oldest of them by their last use.
+    std::vector<PurgeCandidate> candidates;
+    for (Shard& shard : fShards) {
+        SkAutoMutexExclusive ac(shard.fLock);
+        this->internalCollectPurgeCandidates(shard, bytesNeeded, countNeeded, checkPinners, keep,
+                                             &candidates);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const PurgeCandidate& a, const PurgeCandidate& b) {
+                  return a.fLastUse < b.fLastUse;
+              });
+
+    size_t bytesPicked = 0;
+    int    countPicked = 0;
+    size_t picked = 0;
+    while (picked < candidates.size() && (bytesPicked < bytesNeeded || countPicked < countNeeded)) {
+        bytesPicked += candidates[picked].fMemoryUsed;
+        countPicked += 1;
+        picked += 1;
+    }
+    candidates.resize(picked);
+    std::sort(candidates.begin(), candidates.end(),
+              [](const PurgeCandidate& a, const PurgeCandidate& b) {
+                  return a.fShard < b.fShard;
+              });
+
     size_t  bytesFreed = 0;
     int     countFreed = 0;
-
-    // Start at the tail and proceed backwards deleting; the list is in LRU
-    // order, with unimportant entries at the tail.
-    SkStrike* strike = fTail;
-    while (strike != nullptr && (bytesFreed < bytesNeeded || countFreed < countNeeded)) {
-        SkStrike* prev = strike->fPrev;
-
-        // Only delete if the strike is not pinned.
-        if (strike->fPinner == nullptr || (checkPinners && strike->fPinner->canDelete())) {
-            bytesFreed += strike->fMemoryUsed;
-            countFreed += 1;
-            this->internalRemoveStrike(strike);
+    SkSpan<const PurgeCandidate> remaining(candidates);
+    while (!remaining.empty()) {
+        Shard& shard = *remaining.front().fShard;
+        size_t count = 1;
+        while (count < remaining.size() && remaining[count].fShard == &shard) {
+            count += 1;
         }
-        strike = prev;
+        SkAutoMutexExclusive ac(shard.fLock);
+        this->internalPurgeCandidates(shard, remaining.first(count), checkPinners, keep,
+                                      &bytesFreed, &countFreed);
+        SkDEBUGCODE(this->validate(shard);)
+        remaining = remaining.subspan(count);
     }
 
-    this->validate();
-
 #ifdef SPEW_PURGE_STATUS
     if (countFreed) {
         SkDebugf("purging %dK from font cache [%d entries]\n",
@@ -264,30 +385,82 @@ size_t SkStrikeCache::internalPurge(size_t minBytesNeeded, bool checkPinners) {
     return bytesFreed;
 }
 
-void SkStrikeCache::internalAttachToHead(sk_sp<SkStrike> strike) {
-    SkASSERT(fStrikeLookup.find(strike->getDescriptor()) == nullptr);
+bool SkStrikeCache::CanPurge(const SkStrike& strike, bool checkPinners, const SkStrike* keep) {
+    // Only delete if the strike is not pinned.
+    return &strike != keep &&
+           (strike.fPinner == nullptr || (checkPinners && strike.fPinner->canDelete()));
+}
+
+void SkStrikeCache::internalCollectPurgeCandidates(Shard& shard,
+                                                   size_t bytesNeeded,
+                                                   int countNeeded,
+                                                   bool checkPinners,
+                                                   const SkStrike* keep,
+                                                   std::vector<PurgeCandidate>* candidates) {
+    // Start at the tail and proceed backwards; the list is in LRU order, with unimportant
+    // entries at the tail.
+    size_t bytes = 0;
+    int    count = 0;
+    for (SkStrike* strike = shard.fTail;
+         strike != nullptr && (bytes < bytesNeeded || count < countNeeded);
+         strike = strike->fPrev) {
+        if (CanPurge(*strike, checkPinners, keep)) {
+            bytes += strike->fMemoryUsed;
+            count += 1;
+            candidates->push_back({&shard, strike->fLastUse, strike->fMemoryUsed,
+                                   sk_ref_sp(strike)});
+        }
+    }
+}
+
+void SkStrikeCache::internalPurgeCandidates(Shard& shard,
+                                            SkSpan<const PurgeCandidate> candidates,
+                                            bool checkPinners,
+                                            const SkStrike* keep,
+                                            size_t* bytesFreed,
+                                            int* countFreed) {
+    for (const PurgeCandidate& candidate : candidates) {
+        SkStrike* strike = candidate.fStrike.get();
+        // Skip strikes that another purge removed, or that were used since they were picked.
+        if (strike->fRemoved || strike->fLastUse != candidate.fLastUse ||
+            !CanPurge(*strike, checkPinners, keep)) {
+            continue;
+        }
+        *bytesFreed += strike->fMemoryUsed;
+        *countFreed += 1;
+        this->internalRemoveStrike(shard, strike);
+    }
+}
+
+void SkStrikeCache::internalAttachToHead(Shard& shard, sk_sp<SkStrike> strike) {
+    SkASSERT(shard.fStrikeLookup.find(strike->getDescriptor()) == nullptr);
     SkStrike* strikePtr = strike.get();
-    fStrikeLookup.set(std::move(strike));
+    shard.fStrikeLookup.set(std::move(strike));
     SkASSERT(nullptr == strikePtr->fPrev && nullptr == strikePtr->fNext);
 
+    strikePtr->fLastUse = fUseClock.fetch_add(1, std::memory_order_relaxed);
+    shard.fCacheCount += 1;
+    shard.fMemoryUsed += strikePtr->fMemoryUsed;
     fCacheCount += 1;
     fPinnerCount += strikePtr->fPinner != nullptr ? 1 : 0;
     fTotalMemoryUsed += strikePtr->fMemoryUsed;
 
-    if (fHead != nullptr) {
-        fHead->fPrev = strikePtr;
-        strikePtr->fNext = fHead;
+    if (shard.fHead != nullptr) {
+        shard.fHead->fPrev = strikePtr;
+        strikePtr->fNext = shard.fHead;
     }
 
-    if (fTail == nullptr) {
-        fTail = strikePtr;
+    if (shard.fTail == nullptr) {
+        shard.fTail = strikePtr;
     }
 
-    fHead = strikePtr; // Transfer ownership of strike to the cache list.
+    shard.fHead = strikePtr; // Transfer ownership of strike to the cache list.
 }
 
-void SkStrikeCache::internalRemoveStrike(SkStrike* strike) {
-    SkASSERT(fCacheCount > 0);
+void SkStrikeCache::internalRemoveStrike(Shard& shard, SkStrike* strike) {
+    SkASSERT(shard.fCacheCount > 0);
+    shard.fCacheCount -= 1;
+    shard.fMemoryUsed -= strike->fMemoryUsed;
     fCacheCount -= 1;
     fPinnerCount -= strike->fPinner != nullptr ? 1 : 0;
     fTotalMemoryUsed -= strike->fMemoryUsed;
@@ -295,42 +468,42 @@ void SkStrikeCache::internalRemoveStrike(SkStrike* strike) {
     if (strike->fPrev) {
         strike->fPrev->fNext = strike->fNext;
     } else {
-        fHead = strike->fNext;
+        shard.fHead = strike->fNext;
     }
     if (strike->fNext) {
         strike->fNext->fPrev = strike->fPrev;
     } else {
-        fTail = strike->fPrev;
+        shard.fTail = strike->fPrev;
     }
 
     strike->fPrev = strike->fNext = nullptr;
     strike->fRemoved = true;
-    fStrikeLookup.remove(strike->getDescriptor());
+    shard.fStrikeLookup.remove(strike->getDescriptor());
 }
 
-void SkStrikeCache::validate() const {
 #ifdef SK_DEBUG
+void SkStrikeCache::validate(const Shard& shard) const {
     size_t computedBytes = 0;
     int computedCount = 0;
 
-    const SkStrike* strike = fHead;
+    const SkStrike* strike = shard.fHead;
     while (strike != nullptr) {
         computedBytes += strike->fMemoryUsed;
         computedCount += 1;
-        SkASSERT(fStrikeLookup.findOrNull(strike->getDescriptor()) != nullptr);
+        SkASSERT(shard.fStrikeLookup.findOrNull(strike->getDescriptor()) != nullptr);
         strike = strike->fNext;
     }
 
-    if (fCacheCount != computedCount) {
-        SkDebugf("fCacheCount: %d, computedCount: %d", fCacheCount, computedCount);
+    if (shard.fCacheCount != computedCount) {
+        SkDebugf("fCacheCount: %d, computedCount: %d", shard.fCacheCount, computedCount);
         SK_ABORT("fCacheCount != computedCount");
     }
-    if (fTotalMemoryUsed != computedBytes) {
-        SkDebugf("fTotalMemoryUsed: %zu, computedBytes: %zu", fTotalMemoryUsed, computedBytes);
-        SK_ABORT("fTotalMemoryUsed == computedBytes");
+    if (shard.fMemoryUsed != computedBytes) {
+        SkDebugf("fMemoryUsed: %zu, computedBytes: %zu", shard.fMemoryUsed, computedBytes);
+        SK_ABORT("fMemoryUsed == computedBytes");
     }
-#endif
 }
+#endif
 
 const SkDescriptor& SkStrikeCache::StrikeTraits::GetKey(const sk_sp<SkStrike>& strike) {
     return strike->getDescriptor();
@@ -11,17 +11,23 @@
 #include "include/core/SkRefCnt.h"
 #include "include/private/base/SkLoadUserConfig.h" // IWYU pragma: keep
 #include "include/private/base/SkMutex.h"
+#include "include/private/base/SkSpan_impl.h"
 #include "include/private/base/SkThreadAnnotations.h"
+#include "src/core/SkGlyph.h"
 #include "src/core/SkStrike.h"
 #include "src/core/SkTHash.h"
 #include "src/text/StrikeForGPU.h"
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
 class SkDescriptor;
+class SkExecutor;
+class SkStrikeDiskCache;
 class SkStrikeSpec;
 class SkTraceMemoryDump;
 struct SkFontMetrics;
@@ -40,21 +46,37 @@ struct SkFontMetrics;
 
 class SkStrikeCache final : public sktext::StrikeForGPUCacheInterface {
 public:
-    SkStrikeCache() = default;
+    SkStrikeCache();
+    ~SkStrikeCache() override;
 
     static SkStrikeCache* GlobalStrikeCache();
 
-    sk_sp<SkStrike> findStrike(const SkDescriptor& desc) SK_EXCLUDES(fLock);
+    sk_sp<SkStrike> findStrike(const SkDescriptor& desc);
 
     sk_sp<SkStrike> createStrike(
             const SkStrikeSpec& strikeSpec,
             SkFontMetrics* maybeMetrics = nullptr,
-            std::unique_ptr<SkStrikePinner> = nullptr) SK_EXCLUDES(fLock);
+            std::unique_ptr<SkStrikePinner> = nullptr);
 
-    sk_sp<SkStrike> findOrCreateStrike(const SkStrikeSpec& strikeSpec) SK_EXCLUDES(fLock);
+    sk_sp<SkStrike> findOrCreateStrike(const SkStrikeSpec& strikeSpec);
 
     sk_sp<sktext::StrikeForGPU> findOrCreateScopedStrike(
-            const SkStrikeSpec& strikeSpec) override SK_EXCLUDES(fLock);
+            const SkStrikeSpec& strikeSpec) override;
+
+    // Glyphs that will be drawn with one strike. fAction selects what is generated: images for
+    // the mask actions (SDFs when the spec is an SDFT spec), or paths or drawables.
+    struct GlyphBatch {
+        const SkStrikeSpec* fStrikeSpec;
+        SkSpan<const SkPackedGlyphID> fGlyphIDs;
+        skglyph::ActionType fAction;
+    };
+
+    // Warm the cache with the glyphs of each batch, generating them on the executor's threads.
+    // Returns once all batches are done. Different strikes are worked on concurrently; a strike
+    // uses its scaler context under its own lock, so one large batch is not split. The glyphs are
+    // subject to the cache budget like any others, so a prerasterized strike may be purged
+    // before it is drawn if the batches exceed the budget.
+    void prerasterize(SkSpan<const GlyphBatch> batches, SkExecutor& executor);
 
     static void PurgeAll();
     static void Dump();
@@ -63,55 +85,120 @@ public:
     // SkTraceMemoryDump interface.
     static void DumpMemoryStatistics(SkTraceMemoryDump* dump);
 
-    void purgeAll() SK_EXCLUDES(fLock); // does not change budget
-    void purgePinned(size_t minBytesNeeded = 0) SK_EXCLUDES(fLock);
+    void purgeAll(); // does not change budget
+    void purgePinned(size_t minBytesNeeded = 0);
+
+    int getCacheCountLimit() const;
+    int setCacheCountLimit(int limit);
+    int getCacheCountUsed() const;
+
+    size_t getCacheSizeLimit() const;
+    size_t setCacheSizeLimit(size_t limit);
+    size_t getTotalMemoryUsed() const;
 
-    int getCacheCountLimit() const SK_EXCLUDES(fLock);
-    int setCacheCountLimit(int limit) SK_EXCLUDES(fLock);
-    int getCacheCountUsed() const SK_EXCLUDES(fLock);
+    // Strikes created by findOrCreateStrike() first merge any glyphs stored in diskCache, and
+    // storeToDiskCache() stores the glyphs of all strikes in it. It can be replaced, or removed
+    // with nullptr, at any time; threads still using the previous one keep a reference to it.
+    void setDiskCache(sk_sp<SkStrikeDiskCache> diskCache) SK_EXCLUDES(fDiskCacheLock);
 
-    size_t getCacheSizeLimit() const SK_EXCLUDES(fLock);
-    size_t setCacheSizeLimit(size_t limit) SK_EXCLUDES(fLock);
-    size_t getTotalMemoryUsed() const SK_EXCLUDES(fLock);
+    // Returns the number of strikes stored.
+    int storeToDiskCache() SK_EXCLUDES(fDiskCacheLock);
 
 private:
-    friend class SkStrike;  // for SkStrike::updateDelta
+    friend class SkStrike;  // for SkStrike::updateMemoryUsage
     static constexpr char kGlyphCacheDumpName[] = "skia/sk_glyph_cache";
-    sk_sp<SkStrike> internalFindStrikeOrNull(const SkDescriptor& desc) SK_REQUIRES(fLock);
+
+    // Strikes are spread over shards by descriptor hash so that threads working with different
+    // strikes do not contend on one lock. Each shard keeps its own LRU list; the budgets apply to
+    // the totals across all shards, and purging removes the least recently used strikes of the
+    // whole cache, by the use clock stamped on each strike.
+    static constexpr int kShardBits = 4;
+    static constexpr int kShardCount = 1 << kShardBits;
+
+    struct StrikeTraits {
+        static const SkDescriptor& GetKey(const sk_sp<SkStrike>& strike);
+        static uint32_t Hash(const SkDescriptor& descriptor);
+    };
+
+    struct Shard {
+        mutable SkMutex fLock;
+        SkStrike* fHead SK_GUARDED_BY(fLock) {nullptr};
+        SkStrike* fTail SK_GUARDED_BY(fLock) {nullptr};
+        skia_private::THashTable<sk_sp<SkStrike>, SkDescriptor, StrikeTraits> fStrikeLookup
+                SK_GUARDED_BY(fLock);
+        size_t  fMemoryUsed SK_GUARDED_BY(fLock) {0};
+        int32_t fCacheCount SK_GUARDED_BY(fLock) {0};
+    };
+
+    Shard& shardFor(const SkDescriptor& desc);
+
+    // Creates a strike with the glyphs stored in fDiskCache, and adds it to the shard unless
+    // another thread added one for the same descriptor first.
+    sk_sp<SkStrike> createStrikeFromDiskCache(Shard& shard, const SkStrikeSpec& strikeSpec)
+            SK_EXCLUDES(shard.fLock, fDiskCacheLock);
+
+    sk_sp<SkStrikeDiskCache> diskCache() const SK_EXCLUDES(fDiskCacheLock);
+
+    sk_sp<SkStrike> internalFindStrikeOrNull(Shard& shard, const SkDescriptor& desc)
+            SK_REQUIRES(shard.fLock);
     sk_sp<SkStrike> internalCreateStrike(
+            Shard& shard,
             const SkStrikeSpec& strikeSpec,
             SkFontMetrics* maybeMetrics = nullptr,
-            std::unique_ptr<SkStrikePinner> = nullptr) SK_REQUIRES(fLock);
+            std::unique_ptr<SkStrikePinner> = nullptr) SK_REQUIRES(shard.fLock);
 
-    // The following methods can only be called when mutex is already held.
-    void internalRemoveStrike(SkStrike* strike) SK_REQUIRES(fLock);
-    void internalAttachToHead(sk_sp<SkStrike> strike) SK_REQUIRES(fLock);
+    // The following methods can only be called when the shard's mutex is already held.
+    void internalRemoveStrike(Shard& shard, SkStrike* strike) SK_REQUIRES(shard.fLock);
+    void internalAttachToHead(Shard& shard, sk_sp<SkStrike> strike) SK_REQUIRES(shard.fLock);
 
-    // Checkout budgets, modulated by the specified min-bytes-needed-to-purge,
-    // and attempt to purge caches to match.
+    // Checkout budgets, modulated by the specified min-bytes-needed-to-purge, and attempt to
+    // purge caches to match, never removing keep. Shards are locked one at a time.
     // Returns number of bytes freed.
-    size_t internalPurge(size_t minBytesNeeded = 0, bool checkPinners = false) SK_REQUIRES(fLock);
+    size_t purge(size_t minBytesNeeded = 0, bool checkPinners = false,
+                 const SkStrike* keep = nullptr);
+
+    // A strike that a purge may remove, with the state it had when it was picked.
+    struct PurgeCandidate {
+        Shard* fShard;
+        uint64_t fLastUse;
+        size_t fMemoryUsed;
+        sk_sp<SkStrike> fStrike;
+    };
 
-    // A simple accounting of what each glyph cache reports and the strike cache total.
-    void validate() const SK_REQUIRES(fLock);
+    static bool CanPurge(const SkStrike& strike, bool checkPinners, const SkStrike* keep);
 
-    void forEachStrike(std::function<void(const SkStrike&)> visitor) const SK_EXCLUDES(fLock);
+    // Appends the shard's LRU strikes that can be removed to candidates, until they alone would
+    // meet bytesNeeded and countNeeded.
+    void internalCollectPurgeCandidates(Shard& shard, size_t bytesNeeded, int countNeeded,
+                                        bool checkPinners, const SkStrike* keep,
+                                        std::vector<PurgeCandidate>* candidates)
+            SK_REQUIRES(shard.fLock);
 
-    mutable SkMutex fLock;
-    SkStrike* fHead SK_GUARDED_BY(fLock) {nullptr};
-    SkStrike* fTail SK_GUARDED_BY(fLock) {nullptr};
-    struct StrikeTraits {
-        static const SkDescriptor& GetKey(const sk_sp<SkStrike>& strike);
-        static uint32_t Hash(const SkDescriptor& descriptor);
-    };
-    skia_private::THashTable<sk_sp<SkStrike>, SkDescriptor, StrikeTraits> fStrikeLookup
-            SK_GUARDED_BY(fLock);
-
-    size_t  fCacheSizeLimit{SK_DEFAULT_FONT_CACHE_LIMIT};
-    size_t  fTotalMemoryUsed SK_GUARDED_BY(fLock) {0};
-    int32_t fCacheCountLimit{SK_DEFAULT_FONT_CACHE_COUNT_LIMIT};
-    int32_t fCacheCount SK_GUARDED_BY(fLock) {0};
-    int32_t fPinnerCount SK_GUARDED_BY(fLock) {0};
+    // Removes the candidates of the shard that are still unused since they were picked. Adds what
+    // was freed to bytesFreed and countFreed.
+    void internalPurgeCandidates(Shard& shard, SkSpan<const PurgeCandidate> candidates,
+                                 bool checkPinners, const SkStrike* keep,
+                                 size_t* bytesFreed, int* countFreed) SK_REQUIRES(shard.fLock);
+
+#ifdef SK_DEBUG
+    // A simple accounting of what each glyph cache reports and the shard total.
+    void validate(const Shard& shard) const SK_REQUIRES(shard.fLock);
+#endif
+
+    void forEachStrike(std::function<void(const SkStrike&)> visitor) const;
+
+    Shard fShards[kShardCount];
+    mutable SkMutex fDiskCacheLock;
+    sk_sp<SkStrikeDiskCache> fDiskCache SK_GUARDED_BY(fDiskCacheLock);
+    // Whether fDiskCache is set; lets lookups skip fDiskCacheLock when it is not.
+    std::atomic<bool> fUsesDiskCache{false};
+
+    std::atomic<size_t>  fCacheSizeLimit{SK_DEFAULT_FONT_CACHE_LIMIT};
+    std::atomic<size_t>  fTotalMemoryUsed{0};
+    std::atomic<int32_t> fCacheCountLimit{SK_DEFAULT_FONT_CACHE_COUNT_LIMIT};
+    std::atomic<int32_t> fCacheCount{0};
+    std::atomic<int32_t> fPinnerCount{0};
+    std::atomic<uint64_t> fUseClock{0};
 };
 
 #endif  // SkStrikeCache_DEFINED
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "src/core/SkStrikeDiskCache.h"
+
+#include "include/core/SkData.h"
+#include "include/core/SkFontArguments.h"
+#include "include/core/SkFontStyle.h"
+#include "include/core/SkSpan.h"
+#include "include/core/SkStream.h"
+#include "include/core/SkTypeface.h"
+#include "include/core/SkTypes.h"
+#include "include/private/base/SkAlign.h"
+#include "include/private/base/SkTemplates.h"
+#include "src/base/SkSafeMath.h"
+#include "src/base/SkTime.h"
+#include "src/core/SkChecksum.h"
+#include "src/core/SkDescriptor.h"
+#include "src/core/SkOSFile.h"
+#include "src/core/SkPicturePriv.h"
+#include "src/core/SkReadBuffer.h"
+#include "src/core/SkScalerContext.h"
+#include "src/core/SkStrike.h"
+#include "src/core/SkStrikeSpec.h"
+#include "src/core/SkWriteBuffer.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+constexpr uint32_t kMagic = SkSetFourByteTag('s', 'k', 'g', 'c');
+// Bump this when the layout of the file or of the flattened glyphs changes.
+constexpr uint32_t kFormatVersion = 1;
+
+struct Header {
+    uint32_t fMagic;
+    uint32_t fFormatVersion;
+    uint32_t fPictureVersion;  // drawables are stored as pictures
+    uint32_t fKeySize;
+    uint32_t fPayloadSize;
+    uint32_t fPayloadChecksum;
+};
+
+void write_string(SkWStream* stream, const SkString& string) {
+    stream->write32(SkToU32(string.size()));
+    stream->write(string.c_str(), string.size());
+}
+}  // namespace
+
+SkStrikeDiskCache::SkStrikeDiskCache(const char directory[]) : fDirectory(directory) {}
+
+sk_sp<SkData> SkStrikeDiskCache::MakeKey(const SkStrike& strike) {
+    const SkTypeface& typeface = strike.strikeSpec().typeface();
+    for (SkFontTableTag tag : {SkSetFourByteTag('C', 'P', 'A', 'L'),
+                               SkSetFourByteTag('S', 'V', 'G', ' ')}) {
+        if (typeface.getTableSize(tag) != 0) {
+            return nullptr;
+        }
+    }
+
+    // The 'head' table holds the checksum of the whole font file and its revision.
+    constexpr SkFontTableTag kHeadTag = SkSetFourByteTag('h', 'e', 'a', 'd');
+    const size_t headSize = typeface.getTableSize(kHeadTag);
+    if (headSize == 0) {
+        return nullptr;
+    }
+    skia_private::AutoTMalloc<uint8_t> head(headSize);
+    if (typeface.getTableData(kHeadTag, 0, headSize, head.get()) != headSize) {
+        return nullptr;
+    }
+
+    SkDynamicMemoryWStream key;
+    key.write32(SkToU32(headSize));
+    key.write(head.get(), headSize);
+    key.write32(typeface.countGlyphs());
+
+    SkString name;
+    typeface.getFamilyName(&name);
+    write_string(&key, name);
+    name.reset();
+    typeface.getPostScriptName(&name);
+    write_string(&key, name);
+
+    const SkFontStyle style = typeface.fontStyle();
+    key.write32(style.weight());
+    key.write32(style.width());
+    key.write32(style.slant());
+
+    using Coordinate = SkFontArguments::VariationPosition::Coordinate;
+    const int axisCount = typeface.getVariationDesignPosition({});
+    key.write32(axisCount);
+    if (axisCount > 0) {
+        skia_private::AutoTArray<Coordinate> coordinates(axisCount);
+        if (typeface.getVariationDesignPosition({coordinates.get(), axisCount}) != axisCount) {
+            return nullptr;
+        }
+        key.write(coordinates.get(), axisCount * sizeof(Coordinate));
+    }
+
+    // The descriptor refers to the typeface by its ID, which is only meaningful in this process.
+    SkAutoDescriptor desc(strike.getDescriptor());
+    uint32_t recSize;
+    auto rec = static_cast<const SkScalerContextRec*>(
+            desc.getDesc()->findEntry(kRec_SkDescriptorTag, &recSize));
+    if (rec == nullptr || recSize != sizeof(SkScalerContextRec)) {
+        return nullptr;
+    }
+    const_cast<SkScalerContextRec*>(rec)->fTypefaceID = 0;
+
+    // Skip the descriptor's checksum, which covers the typeface ID.
+    const size_t descSize = desc.getDesc()->getLength();
+    key.write(SkTAddOffset<const void>(desc.getDesc(), sizeof(uint32_t)),
+              descSize - sizeof(uint32_t));
+
+    return key.detachAsData();
+}
+
+SkString SkStrikeDiskCache::pathFor(const SkData& key) const {
+    return SkStringPrintf("%s/%016llx.skglyphs", fDirectory.c_str(),
+                          (unsigned long long)SkChecksum::Hash64(key.data(), key.size()));
+}
+
+bool SkStrikeDiskCache::load(SkStrike* strike) const {
+    sk_sp<SkData> key = MakeKey(*strike);
+    if (!key) {
+        return false;
+    }
+
+    sk_sp<SkData> file = SkData::MakeFromFileName(this->pathFor(*key).c_str());
+    if (!file || file->size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (header.fMagic != kMagic ||
+        header.fFormatVersion != kFormatVersion ||
+        header.fPictureVersion != SkPicturePriv::kCurrent_Version ||
+        header.fKeySize != key->size()) {
+        return false;
+    }
+
+    SkSafeMath safe;
+    const size_t payloadOffset = safe.add(sizeof(Header), safe.alignUp(header.fKeySize, 4));
+    const size_t fileSize = safe.add(payloadOffset, header.fPayloadSize);
+    if (!safe || fileSize != file->size()) {
+        return false;
+    }
+
+    // A different key with the same hash.
+    if (memcmp(file->bytes() + sizeof(Header), key->data(), key->size()) != 0) {
+        return false;
+    }
+
+    const uint8_t* payload = file->bytes() + payloadOffset;
+    if (SkChecksum::Hash32(payload, header.fPayloadSize) != header.fPayloadChecksum) {
+        return false;
+    }
+
+    SkReadBuffer buffer{payload, header.fPayloadSize};
+    return strike->mergeFromBuffer(buffer) && buffer.isValid();
+}
+
+bool SkStrikeDiskCache::store(SkStrike* strike) const {
+    sk_sp<SkData> key = MakeKey(*strike);
+    if (!key) {
+        return false;
+    }
+
+    SkBinaryWriteBuffer buffer{nullptr, 0, {}};
+    strike->flattenGlyphs(buffer);
+    sk_sp<SkData> payload = buffer.snapshotAsData();
+
+    Header header;
+    header.fMagic = kMagic;
+    header.fFormatVersion = kFormatVersion;
+    header.fPictureVersion = SkPicturePriv::kCurrent_Version;
+    header.fKeySize = SkToU32(key->size());
+    header.fPayloadSize = SkToU32(payload->size());
+    header.fPayloadChecksum = SkChecksum::Hash32(payload->data(), payload->size());
+
+    if (!sk_isdir(fDirectory.c_str()) && !sk_mkdir(fDirectory.c_str())) {
+        return false;
+    }
+
+    // Concurrent writers, in this or other processes, each use their own temporary file.
+    const SkString path = this->pathFor(*key);
+    const SkString tempPath = SkStringPrintf(
+            "%s.%llx.tmp", path.c_str(),
+            (unsigned long long)SkTime::GetNSecs() ^ (uintptr_t)&header);
+    bool written;
+    {
+        SkFILEWStream out(tempPath.c_str());
+        static constexpr uint8_t kPadding[4] = {0, 0, 0, 0};
+        written = out.isValid() &&
+                  out.write(&header, sizeof(header)) &&
+                  out.write(key->data(), key->size()) &&
+                  out.write(kPadding, SkAlign4(key->size()) - key->size()) &&
+                  out.write(payload->data(), payload->size());
+    }
+    if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
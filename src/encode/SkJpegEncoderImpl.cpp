@@ -7,6 +7,8 @@
 
 #include "src/encode/SkJpegEncoderImpl.h"
 
+#include "include/codec/SkCodec.h"
+#include "include/codec/SkEncodedOrigin.h"
 #include "include/core/SkAlphaType.h"
 #include "include/core/SkBitmap.h"
 #include "include/core/SkColorType.h"
@@ -14,6 +16,8 @@
 #include "include/core/SkImageInfo.h"
 #include "include/core/SkPixmap.h"
 #include "include/core/SkRefCnt.h"
+#include "include/core/SkSamplingOptions.h"
+#include "include/core/SkSize.h"
 #include "include/core/SkStream.h"
 #include "include/core/SkYUVAInfo.h"
 #include "include/core/SkYUVAPixmaps.h"
@@ -23,6 +27,7 @@
 #include "include/private/base/SkDebug.h"
 #include "include/private/base/SkNoncopyable.h"
 #include "include/private/base/SkTemplates.h"
+#include "include/private/base/SkTo.h"
 #include "src/base/SkMSAN.h"
 #include "src/codec/SkJpegConstants.h"
 #include "src/codec/SkJpegPriv.h"
@@ -33,6 +38,7 @@
 #include "src/encode/SkJPEGWriteUtility.h"
 #include "src/image/SkImage_Base.h"
 
+#include <algorithm>
 #include <csetjmp>
 #include <cstdint>
 #include <cstring>
@@ -273,6 +279,12 @@ bool SkJpegEncoderMgr::initializeYUV(const SkYUVAPixmapInfo& srcInfo,
     fCInfo.comp_info[0].h_samp_factor = ssHoriz;
     fCInfo.comp_info[0].v_samp_factor = ssVert;
 
+    // Separate planes already have the layout libjpeg-turbo downsamples to, so they can be
+    // written directly instead of being interleaved (and upsampled) by yuva_copy_row.
+    if (srcInfo.yuvaInfo().planeConfig() == SkYUVAInfo::PlaneConfig::kY_U_V) {
+        fCInfo.raw_data_in = TRUE;
+    }
+
     initializeCommon(options, metadataSegments);
     return true;
 }
@@ -358,8 +370,11 @@ bool SkJpegEncoderImpl::onEncodeRows(int numRows) {
         return false;
     }
 
-    if (fSrcYUVA) {
-        // TODO(ccameron): Consider using jpeg_write_raw_data, to avoid having to re-pack the data.
+    if (fSrcYUVA && fEncoderMgr->cinfo()->raw_data_in) {
+        if (!this->writeRawRows(fCurrRow + numRows)) {
+            return false;
+        }
+    } else if (fSrcYUVA) {
         for (int i = 0; i < numRows; i++) {
             yuva_copy_row(*fSrcYUVA, fCurrRow + i, fStorage.get());
             JSAMPLE* jpegSrcRow = fStorage.get();
@@ -399,6 +414,59 @@ bool SkJpegEncoderImpl::onEncodeRows(int numRows) {
     return true;
 }
 
+bool SkJpegEncoderImpl::writeRawRows(int availableRows) {
+    jpeg_compress_struct* cinfo = fEncoderMgr->cinfo();
+    const int height = SkToInt(cinfo->image_height);
+    const int rowsPerIMCU = cinfo->max_v_samp_factor * DCTSIZE;
+    SkASSERT(cinfo->num_components == 3);
+    SkASSERT(rowsPerIMCU <= 2 * DCTSIZE);
+
+    // libjpeg-turbo reads whole blocks, so each plane is copied into block-padded rows with the
+    // edge pixels replicated, as it would do itself when downsampling.
+    size_t paddedWidths[3];
+    if (!fRawStorage.get()) {
+        size_t storageSize = 0;
+        for (int c = 0; c < 3; ++c) {
+            storageSize += cinfo->comp_info[c].width_in_blocks * DCTSIZE *
+                           cinfo->comp_info[c].v_samp_factor * DCTSIZE;
+        }
+        fRawStorage.reset(storageSize);
+    }
+    for (int c = 0; c < 3; ++c) {
+        paddedWidths[c] = cinfo->comp_info[c].width_in_blocks * DCTSIZE;
+    }
+
+    JSAMPROW rowPtrs[3][2 * DCTSIZE];
+    JSAMPARRAY planes[3] = {rowPtrs[0], rowPtrs[1], rowPtrs[2]};
+    while (SkToInt(cinfo->next_scanline) < height) {
+        const int top = cinfo->next_scanline;
+        if (top + rowsPerIMCU > availableRows && availableRows < height) {
+            // Wait for the rest of this iMCU row.
+            break;
+        }
+
+        uint8_t* storage = fRawStorage.get();
+        for (int c = 0; c < 3; ++c) {
+            const SkPixmap& plane = fSrcYUVA->plane(c);
+            const int vSamp = cinfo->comp_info[c].v_samp_factor;
+            const int planeTop = top * vSamp / cinfo->max_v_samp_factor;
+            for (int r = 0; r < vSamp * DCTSIZE; ++r) {
+                const int srcRow = std::min(planeTop + r, plane.height() - 1);
+                memcpy(storage, plane.addr(0, srcRow), plane.width());
+                memset(storage + plane.width(), storage[plane.width() - 1],
+                       paddedWidths[c] - plane.width());
+                rowPtrs[c][r] = storage;
+                storage += paddedWidths[c];
+            }
+        }
+
+        if (jpeg_write_raw_data(cinfo, planes, rowsPerIMCU) != SkToU32(rowsPerIMCU)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 namespace SkJpegEncoder {
 
 bool Encode(SkWStream* dst, const SkPixmap& src, const Options& options) {
@@ -414,6 +482,75 @@ bool Encode(SkWStream* dst,
     return encoder.get() && encoder->encodeRows(src.yuvaInfo().height());
 }
 
+bool Transcode(SkWStream* dst, SkCodec* src, SkISize dstDimensions, const Options& options) {
+    if (!dst || !src || dstDimensions.isEmpty()) {
+        return false;
+    }
+
+    Options encodeOptions = options;
+    if (!encodeOptions.fOrigin.has_value() && src->getOrigin() != kTopLeft_SkEncodedOrigin) {
+        encodeOptions.fOrigin = src->getOrigin();
+    }
+    const sk_sp<SkColorSpace> colorSpace = src->getInfo().refColorSpace();
+    const SkSamplingOptions sampling(SkFilterMode::kLinear, SkMipmapMode::kNearest);
+
+    SkYUVAPixmapInfo srcInfo;
+    if (src->queryYUVAInfo(SkYUVAPixmapInfo::SupportedDataTypes::All(), &srcInfo) &&
+        srcInfo.dataType() == SkYUVAPixmapInfo::DataType::kUnorm8 &&
+        srcInfo.yuvaInfo().planeConfig() == SkYUVAInfo::PlaneConfig::kY_U_V &&
+        srcInfo.yuvColorSpace() == kJPEG_Full_SkYUVColorSpace &&
+        !SkEncodedOriginSwapsWidthHeight(srcInfo.yuvaInfo().origin())) {
+        SkYUVAPixmaps srcPlanes = SkYUVAPixmaps::Allocate(srcInfo);
+        if (srcPlanes.isValid() && src->getYUVAPlanes(srcPlanes) == SkCodec::kSuccess) {
+            if (srcInfo.yuvaInfo().dimensions() == dstDimensions) {
+                return Encode(dst, srcPlanes, colorSpace.get(), encodeOptions);
+            }
+
+            const SkYUVAPixmapInfo dstInfo(srcInfo.yuvaInfo().makeDimensions(dstDimensions),
+                                           SkYUVAPixmapInfo::DataType::kUnorm8,
+                                           /*rowBytes=*/nullptr);
+            SkYUVAPixmaps dstPlanes = SkYUVAPixmaps::Allocate(dstInfo);
+            if (!dstPlanes.isValid()) {
+                return false;
+            }
+            for (int i = 0; i < dstPlanes.numPlanes(); ++i) {
+                if (!srcPlanes.plane(i).scalePixels(dstPlanes.plane(i), sampling)) {
+                    return false;
+                }
+            }
+            return Encode(dst, dstPlanes, colorSpace.get(), encodeOptions);
+        }
+    }
+
+    // Decode at the smallest native scale that is no smaller than the destination.
+    const SkISize srcDimensions = src->dimensions();
+    const float scale = std::max((float)dstDimensions.width() / srcDimensions.width(),
+                                 (float)dstDimensions.height() / srcDimensions.height());
+    SkISize decodeDimensions = src->getScaledDimensions(scale);
+    if (decodeDimensions.width() < dstDimensions.width() ||
+        decodeDimensions.height() < dstDimensions.height()) {
+        decodeDimensions = srcDimensions;
+    }
+
+    const SkImageInfo decodeInfo = src->getInfo().makeDimensions(decodeDimensions)
+                                                 .makeColorType(kRGBA_8888_SkColorType);
+    SkBitmap decoded;
+    if (!decoded.tryAllocPixels(decodeInfo) ||
+        src->getPixels(decoded.pixmap()) != SkCodec::kSuccess) {
+        return false;
+    }
+    if (decodeDimensions == dstDimensions) {
+        return Encode(dst, decoded.pixmap(), encodeOptions);
+    }
+
+    SkBitmap scaled;
+    if (!scaled.tryAllocPixels(decodeInfo.makeDimensions(dstDimensions)) ||
+        !decoded.pixmap().scalePixels(scaled.pixmap(), sampling)) {
+        return false;
+    }
+    return Encode(dst, scaled.pixmap(), encodeOptions);
+}
+
 sk_sp<SkData> Encode(GrDirectContext* ctx, const SkImage* img, const Options& options) {
     if (!img) {
         return nullptr;
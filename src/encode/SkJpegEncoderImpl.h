@@ -13,6 +13,7 @@
 #include "include/core/SkRefCnt.h"
 #include "include/core/SkYUVAPixmaps.h"
 #include "include/encode/SkEncoder.h"
+#include "include/private/base/SkTemplates.h"
 
 #include <cstdint>
 #include <memory>
@@ -82,8 +83,12 @@ private:
     SkJpegEncoderImpl(std::unique_ptr<SkJpegEncoderMgr>, const SkPixmap& src);
     SkJpegEncoderImpl(std::unique_ptr<SkJpegEncoderMgr>, const SkYUVAPixmaps& srcYUVA);
 
+    // Hands complete iMCU rows of Y, U and V planes to libjpeg without repacking them.
+    bool writeRawRows(int availableRows);
+
     std::unique_ptr<SkJpegEncoderMgr> fEncoderMgr;
     std::optional<SkYUVAPixmaps> fSrcYUVA;
+    skia_private::AutoTMalloc<uint8_t> fRawStorage;
 };
 
 #endif
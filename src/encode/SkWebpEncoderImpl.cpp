@@ -14,10 +14,13 @@
 #include "include/core/SkImageInfo.h"
 #include "include/core/SkPixmap.h"
 #include "include/core/SkRefCnt.h"
+#include "include/core/SkScalar.h"
 #include "include/core/SkSpan.h"
 #include "include/core/SkStream.h"
 #include "include/encode/SkEncoder.h"
+#include "include/private/base/SkTPin.h"
 #include "include/private/base/SkTemplates.h"
+#include "src/base/SkTime.h"
 #include "src/core/SkImageInfoPriv.h"
 #include "src/encode/SkImageEncoderFns.h"
 #include "src/encode/SkImageEncoderPriv.h"
@@ -72,21 +75,16 @@ static bool preprocess_webp_picture(WebPPicture* pic,
     pic->width = pixmap.width();
     pic->height = pixmap.height();
 
-    // Set compression, method, and pixel format.
+    // Set compression and pixel format. The method is chosen by configure_effort().
     // libwebp recommends using BGRA for lossless and YUV for lossy.
-    // The choices of |webp_config.method| currently just match Chrome's defaults.  We
-    // could potentially expose this decision to the client.
     if (SkWebpEncoder::Compression::kLossy == opts.fCompression) {
         webp_config->lossless = 0;
-#ifndef SK_WEBP_ENCODER_USE_DEFAULT_METHOD
-        webp_config->method = 3;
-#endif
         pic->use_argb = 0;
     } else {
         webp_config->lossless = 1;
-        webp_config->method = 0;
         pic->use_argb = 1;
     }
+    webp_config->thread_level = opts.fMultithreaded ? 1 : 0;
 
     {
         const SkColorType ct = pixmap.colorType();
@@ -125,6 +123,71 @@ static bool preprocess_webp_picture(WebPPicture* pic,
     return true;
 }
 
+// Rough single-threaded libwebp throughput, in nanoseconds per pixel, indexed by lossy |method|
+// and by lossless level (see WebPConfigLosslessPreset). Only used to fit the effort to
+// Options::fTargetEncodeTimeMs, so relative costs matter more than absolute ones.
+static constexpr float kLossyNsPerPixel[] = {15, 20, 30, 45, 60, 90, 150};
+static constexpr float kLosslessNsPerPixel[] = {30, 60, 80, 120, 200, 300, 450, 700, 1200, 2500};
+
+// Returns the highest level <= maxLevel whose estimated cost fits in |budgetNsPerPixel|.
+static int fit_level(const float* nsPerPixel, int maxLevel, double budgetNsPerPixel) {
+    int level = maxLevel;
+    while (level > 0 && nsPerPixel[level] > budgetNsPerPixel) {
+        --level;
+    }
+    return level;
+}
+
+// Sets |method| (and the lossless effort) from |opts.fEffort|, lowered to fit
+// |opts.fTargetEncodeTimeMs| if set. |timeScale| corrects the cost model with measured encode
+// times. Returns the estimated encode time in milliseconds, or a negative value on failure.
+static double configure_effort(WebPConfig* webp_config,
+                               const WebPPicture& pic,
+                               const SkWebpEncoder::Options& opts,
+                               double timeScale) {
+    using SkWebpEncoder::Effort;
+
+    const double pixels = static_cast<double>(pic.width) * pic.height;
+    const double budgetNsPerPixel = opts.fTargetEncodeTimeMs > 0
+            ? opts.fTargetEncodeTimeMs * 1e6 / (pixels * timeScale)
+            : SK_ScalarInfinity;
+    double nsPerPixel;
+
+    if (SkWebpEncoder::Compression::kLossy == opts.fCompression) {
+        static constexpr int kMethods[] = {3, 0, 2, 4, 6};
+        int method = kMethods[static_cast<int>(opts.fEffort)];
+#ifdef SK_WEBP_ENCODER_USE_DEFAULT_METHOD
+        if (opts.fEffort == Effort::kDefault) {
+            method = webp_config->method;
+        }
+#endif
+        webp_config->method = fit_level(kLossyNsPerPixel, method, budgetNsPerPixel);
+        nsPerPixel = kLossyNsPerPixel[webp_config->method];
+    } else if (opts.fEffort == Effort::kDefault) {
+        // These currently just match Chrome's defaults: the fastest method, with |fQuality|
+        // controlling the effort. Its cost is roughly between lossless levels 0 and 2, so
+        // fit the budget by lowering the quality along that range.
+        webp_config->method = 0;
+        const float minCost = kLosslessNsPerPixel[0];
+        const float maxCost = kLosslessNsPerPixel[2];
+        if (budgetNsPerPixel < minCost + (maxCost - minCost) * webp_config->quality / 100) {
+            webp_config->quality = SkTPin<float>(
+                    100 * (budgetNsPerPixel - minCost) / (maxCost - minCost), 0, 100);
+        }
+        nsPerPixel = minCost + (maxCost - minCost) * webp_config->quality / 100;
+    } else {
+        static constexpr int kLevels[] = {0, 0, 2, 5, 9};
+        const int level = fit_level(kLosslessNsPerPixel, kLevels[static_cast<int>(opts.fEffort)],
+                                    budgetNsPerPixel);
+        if (!WebPConfigLosslessPreset(webp_config, level)) {
+            return -1;
+        }
+        nsPerPixel = kLosslessNsPerPixel[level];
+    }
+
+    return nsPerPixel * pixels * timeScale * 1e-6;
+}
+
 namespace SkWebpEncoder {
 
 bool Encode(SkWStream* stream, const SkPixmap& pixmap, const Options& opts) {
@@ -146,6 +209,9 @@ bool Encode(SkWStream* stream, const SkPixmap& pixmap, const Options& opts) {
     if (!preprocess_webp_picture(&pic, &webp_config, pixmap, opts)) {
         return false;
     }
+    if (configure_effort(&webp_config, pic, opts, 1.0) < 0) {
+        return false;
+    }
 
     // If there is no need to embed an ICC profile, we write directly to the input stream.
     // Otherwise, we will first encode to |tmp| and use a mux to add the ICC chunk.  libwebp
@@ -196,6 +262,7 @@ bool EncodeAnimated(SkWStream* stream, SkSpan<const SkEncoder::Frame> frames, co
     const int canvasWidth = frames.front().pixmap.width();
     const int canvasHeight = frames.front().pixmap.height();
     int timestamp = 0;
+    double timeScale = 1.0;
 
     std::unique_ptr<WebPAnimEncoder, void (*)(WebPAnimEncoder*)> enc(
             WebPAnimEncoderNew(canvasWidth, canvasHeight, nullptr), WebPAnimEncoderDelete);
@@ -224,10 +291,20 @@ bool EncodeAnimated(SkWStream* stream, SkSpan<const SkEncoder::Frame> frames, co
         if (!preprocess_webp_picture(&pic, &webp_config, pixmap, opts)) {
             return false;
         }
+        const double estimatedMs = configure_effort(&webp_config, pic, opts, timeScale);
+        if (estimatedMs < 0) {
+            return false;
+        }
 
+        const double startMs = SkTime::GetMSecs();
         if (!WebPEncode(&webp_config, &pic)) {
             return false;
         }
+        if (opts.fTargetEncodeTimeMs > 0 && estimatedMs > 0) {
+            // Correct the cost model for this machine and content for the next frames.
+            const double elapsedMs = SkTime::GetMSecs() - startMs;
+            timeScale = SkTPin(timeScale * elapsedMs / estimatedMs, 0.1, 10.0);
+        }
 
         if (!WebPAnimEncoderAdd(enc.get(), &pic, timestamp, &webp_config)) {
             return false;
@@ -214,6 +214,9 @@ private:
     // RHEL 8             2.9.1
 };
 
+// Guards the shared FT_Library: its reference count, and creating and destroying faces in it.
+// Everything done with an open face is guarded by that face's FaceRec::fLock instead, so faces of
+// different typefaces can be used in parallel. When both are needed, f_t_mutex() is taken first.
 static SkMutex& f_t_mutex() {
     static SkMutex& mutex = *(new SkMutex);
     return mutex;
@@ -225,6 +228,8 @@ static FreeTypeLibrary* gFTLibrary;
 
 class SkTypeface_FreeType::FaceRec {
 public:
+    // FT_Face is not thread safe; lock this before using fFace.
+    SkMutex fLock;
     SkUniqueFTFace fFace;
     FT_StreamRec fFTStream;
     std::unique_ptr<SkStreamAsset> fSkStream;
@@ -442,13 +447,16 @@ SkTypeface_FreeType::FaceRec::Make(const SkTypeface_FreeType* typeface) {
 
 class AutoFTAccess {
 public:
-    AutoFTAccess(const SkTypeface_FreeType* tf) : fFaceRec(nullptr) {
-        f_t_mutex().acquire();
-        fFaceRec = tf->getFaceRec();
+    AutoFTAccess(const SkTypeface_FreeType* tf) : fFaceRec(tf->getFaceRec()) {
+        if (fFaceRec) {
+            fFaceRec->fLock.acquire();
+        }
     }
 
     ~AutoFTAccess() {
-        f_t_mutex().release();
+        if (fFaceRec) {
+            fFaceRec->fLock.release();
+        }
     }
 
     FT_Face face() { return fFaceRec ? fFaceRec->fFace.get() : nullptr; }
@@ -511,13 +519,13 @@ private:
     bool      fLCDIsVert;
 
     FT_Error setupSize();
-    // Caller must lock f_t_mutex() before calling this function.
+    // Caller must lock fFaceRec->fLock before calling this function.
     static bool getBoundsOfCurrentOutlineGlyph(FT_GlyphSlot glyph, SkRect* bounds);
-    // Caller must lock f_t_mutex() before calling this function.
+    // Caller must lock fFaceRec->fLock before calling this function.
     bool getCBoxForLetter(char letter, FT_BBox* bbox);
     static void updateGlyphBoundsIfSubpixel(const SkGlyph&, SkRect* bounds, bool subpixel);
     void updateGlyphBoundsIfLCD(GlyphMetrics* mx);
-    // Caller must lock f_t_mutex() before calling this function.
+    // Caller must lock fFaceRec->fLock before calling this function.
     // update FreeType2 glyph slot with glyph emboldened
     bool emboldenIfNeeded(FT_Face face, FT_GlyphSlot glyph, SkGlyphID gid);
     bool shouldSubpixelBitmap(const SkGlyph&, const SkMatrix&);
@@ -928,7 +936,6 @@ SkScalerContext_FreeType::SkScalerContext_FreeType(const SkTypeface_FreeType& re
     , fFTSize(nullptr)
     , fStrikeIndex(-1)
 {
-    SkAutoMutexExclusive  ac(f_t_mutex());
     fFaceRec = realTypeface.getFaceRec();  // The proxyTypeface owns the realTypeface.
 
     // load the font file
@@ -936,6 +943,7 @@ SkScalerContext_FreeType::SkScalerContext_FreeType(const SkTypeface_FreeType& re
         LOG_INFO("Could not create FT_Face.\n");
         return;
     }
+    SkAutoMutexExclusive  ac(fFaceRec->fLock);
 
     fLCDIsVert = SkToBool(fRec.fFlags & SkScalerContext::kLCD_Vertical_Flag);
 
@@ -1106,9 +1114,8 @@ SkScalerContext_FreeType::SkScalerContext_FreeType(const SkTypeface_FreeType& re
 }
 
 SkScalerContext_FreeType::~SkScalerContext_FreeType() {
-    SkAutoMutexExclusive  ac(f_t_mutex());
-
     if (fFTSize != nullptr) {
+        SkAutoMutexExclusive  ac(fFaceRec->fLock);
         FT_Done_Size(fFTSize);
     }
 
@@ -1119,7 +1126,7 @@ SkScalerContext_FreeType::~SkScalerContext_FreeType() {
     this face with other context (at different sizes).
 */
 FT_Error SkScalerContext_FreeType::setupSize() {
-    f_t_mutex().assertHeld();
+    fFaceRec->fLock.assertHeld();
     FT_Error err = FT_Activate_Size(fFTSize);
     if (err != 0) {
         return err;
@@ -1199,7 +1206,7 @@ bool SkScalerContext_FreeType::shouldSubpixelBitmap(const SkGlyph& glyph, const
 
 SkScalerContext::GlyphMetrics SkScalerContext_FreeType::generateMetrics(const SkGlyph& glyph,
                                                                         SkArenaAlloc* alloc) {
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    SkAutoMutexExclusive  ac(fFaceRec->fLock);
 
     GlyphMetrics mx(glyph.maskFormat());
 
@@ -1378,7 +1385,7 @@ SkScalerContext::GlyphMetrics SkScalerContext_FreeType::generateMetrics(const Sk
 }
 
 void SkScalerContext_FreeType::generateImage(const SkGlyph& glyph, void* imageBuffer) {
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    SkAutoMutexExclusive  ac(fFaceRec->fLock);
 
     if (this->setupSize()) {
         sk_bzero(imageBuffer, glyph.imageSize());
@@ -1447,11 +1454,11 @@ void SkScalerContext_FreeType::generateImage(const SkGlyph& glyph, void* imageBu
 sk_sp<SkDrawable> SkScalerContext_FreeType::generateDrawable(const SkGlyph& glyph) {
     // Because FreeType's FT_Face is stateful (not thread safe) and the current design of this
     // SkTypeface and SkScalerContext does not work around this, it is necessary lock at least the
-    // FT_Face when using it (this implementation currently locks the whole FT_Library).
+    // FT_Face when using it.
     // It should be possible to draw the drawable straight out of the FT_Face. However, this would
     // mean locking each time any such drawable is drawn. To avoid locking, this implementation
     // creates drawables backed as pictures so that they can be played back later without locking.
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    SkAutoMutexExclusive  ac(fFaceRec->fLock);
 
     if (this->setupSize()) {
         return nullptr;
@@ -1502,7 +1509,7 @@ sk_sp<SkDrawable> SkScalerContext_FreeType::generateDrawable(const SkGlyph& glyp
 bool SkScalerContext_FreeType::generatePath(const SkGlyph& glyph, SkPath* path, bool* modified) {
     SkASSERT(path);
 
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    SkAutoMutexExclusive  ac(fFaceRec->fLock);
 
     SkGlyphID glyphID = glyph.getGlyphID();
     // FT_IS_SCALABLE is documented to mean the face contains outline glyphs.
@@ -1545,7 +1552,7 @@ void SkScalerContext_FreeType::generateFontMetrics(SkFontMetrics* metrics) {
         return;
     }
 
-    SkAutoMutexExclusive ac(f_t_mutex());
+    SkAutoMutexExclusive ac(fFaceRec->fLock);
 
     if (this->setupSize()) {
         sk_bzero(metrics, sizeof(*metrics));
@@ -1958,8 +1965,10 @@ sk_sp<SkData> SkTypeface_FreeType::onCopyTableData(SkFontTableTag tag) const {
 }
 
 SkTypeface_FreeType::FaceRec* SkTypeface_FreeType::getFaceRec() const {
-    f_t_mutex().assertHeld();
-    fFTFaceOnce([this]{ fFaceRec = SkTypeface_FreeType::FaceRec::Make(this); });
+    fFTFaceOnce([this]{
+        SkAutoMutexExclusive ac(f_t_mutex());
+        fFaceRec = SkTypeface_FreeType::FaceRec::Make(this);
+    });
     return fFaceRec.get();
 }
 
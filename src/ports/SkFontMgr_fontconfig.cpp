@@ -6,6 +6,7 @@
  */
 #include "include/ports/SkFontMgr_fontconfig.h"
 
+#include "include/core/SkData.h"
 #include "include/core/SkDataTable.h"
 #include "include/core/SkFontArguments.h"
 #include "include/core/SkFontMgr.h"
@@ -28,16 +29,24 @@
 #include "src/core/SkAdvancedTypefaceMetrics.h"
 #include "src/core/SkFontDescriptor.h"
 #include "src/core/SkOSFile.h"
+#include "src/core/SkReadBuffer.h"
 #include "src/core/SkScalerContext.h"
+#include "src/core/SkTHash.h"
 #include "src/core/SkTypefaceCache.h"
+#include "src/core/SkWriteBuffer.h"
+#include "src/ports/SkFontMgr_custom.h"
 #include "src/ports/SkTypeface_proxy.h"
 
 #include <fontconfig/fontconfig.h>
 
 #include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <utility>
 
@@ -547,6 +556,41 @@ private:
     {}
 };
 
+/** A snapshot is an SkBinaryWriteBuffer holding, in order:
+ *    the magic and version;
+ *    the FontConfig configuration files and font directories, each with its modification time;
+ *    the accessible fonts, each with its resolved file, index, style, spacing and family name;
+ *    the families, each with its name and the indices of its fonts;
+ *    the generic names, each with the index of the family FontConfig resolved it to;
+ *    the index of the default family, or -1.
+ */
+static constexpr uint32_t kSnapshotMagic = SkSetFourByteTag('s', 'k', 'f', 'c');
+static constexpr uint32_t kSnapshotVersion = 1;
+
+static const char* const kSnapshotGenericNames[] = {
+    "sans-serif", "serif", "monospace", "cursive", "fantasy", "system-ui", "emoji", "math",
+    "fangsong", "sans", "mono",
+};
+
+static int64_t modified_time(const char path[]) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    return st.st_mtime;
+}
+
+static void write_time(SkWriteBuffer& buffer, int64_t time) {
+    buffer.writeUInt(static_cast<uint32_t>(static_cast<uint64_t>(time)));
+    buffer.writeUInt(static_cast<uint32_t>(static_cast<uint64_t>(time) >> 32));
+}
+
+static int64_t read_time(SkReadBuffer& buffer) {
+    uint64_t lo = buffer.readUInt();
+    uint64_t hi = buffer.readUInt();
+    return static_cast<int64_t>(lo | (hi << 32));
+}
+
 class SkFontMgr_fontconfig : public SkFontMgr {
     mutable SkAutoFcConfig fFC;  // Only mutable to avoid const cast when passed to FontConfig API.
     const SkString fSysroot;
@@ -717,6 +761,157 @@ public:
         fFC.reset();
     }
 
+    /** Writes the snapshot read by SkFontMgr_fontconfig_snapshot. */
+    bool writeSnapshot(SkWStream* stream) const {
+        struct Font {
+            SkString fPath;
+            int fIndex;
+            SkFontStyle fStyle;
+            bool fIsFixedPitch;
+            SkString fFamilyName;
+        };
+        TArray<SkString> watched;
+        TArray<Font> fonts;
+        TArray<SkString> familyNames;
+        TArray<TArray<int>> familyFonts;
+        THashMap<SkString, int> familyIndices;
+        {
+            FCLocker lock;
+
+            // FontConfig rescans when one of these changes, so the snapshot is stale when they do.
+            for (FcStrList* list : { FcConfigGetConfigFiles(fFC), FcConfigGetFontDirs(fFC) }) {
+                if (!list) {
+                    continue;
+                }
+                while (FcChar8* path = FcStrListNext(list)) {
+                    watched.push_back(SkString(reinterpret_cast<const char*>(path)));
+                }
+                FcStrListDone(list);
+            }
+
+            // Fonts in a collection share a file, so only scan it once.
+            THashMap<SkString, bool> accessibleFiles;
+            static const FcSetName fcNameSet[] = { FcSetSystem, FcSetApplication };
+            for (int setIndex = 0; setIndex < (int)std::size(fcNameSet); ++setIndex) {
+                // Return value of FcConfigGetFonts must not be destroyed.
+                FcFontSet* allFonts(FcConfigGetFonts(fFC, fcNameSet[setIndex]));
+                if (nullptr == allFonts) {
+                    continue;
+                }
+
+                for (int fontIndex = 0; fontIndex < allFonts->nfont; ++fontIndex) {
+                    FcPattern* font = allFonts->fonts[fontIndex];
+                    const char* filename = get_string(font, FC_FILE, nullptr);
+                    if (nullptr == filename) {
+                        continue;
+                    }
+                    SkString key(filename);
+                    bool* accessible = accessibleFiles.find(key);
+                    if (!accessible) {
+                        accessible = accessibleFiles.set(key, FontAccessible(font));
+                    }
+                    if (!*accessible) {
+                        continue;
+                    }
+
+                    // See FontAccessible for note on searching sysroot then non-sysroot path.
+                    SkString path(filename);
+                    if (!fSysroot.isEmpty()) {
+                        SkString resolvedFilename = fSysroot;
+                        resolvedFilename += filename;
+                        if (sk_exists(resolvedFilename.c_str(), kRead_SkFILE_Flag)) {
+                            path = resolvedFilename;
+                        }
+                    }
+
+                    const int index = fonts.size();
+                    fonts.push_back({path,
+                                     get_int(font, FC_INDEX, 0),
+                                     skfontstyle_from_fcpattern(font),
+                                     FC_PROPORTIONAL != get_int(font, FC_SPACING, FC_PROPORTIONAL),
+                                     SkString(get_string(font, FC_FAMILY))});
+
+                    for (int id = 0; ; ++id) {
+                        FcChar8* fcFamilyName;
+                        FcResult result = FcPatternGetString(font, FC_FAMILY, id, &fcFamilyName);
+                        if (FcResultNoId == result) {
+                            break;
+                        }
+                        if (FcResultMatch != result) {
+                            continue;
+                        }
+                        SkString familyName(reinterpret_cast<const char*>(fcFamilyName));
+                        int* familyIndex = familyIndices.find(familyName);
+                        if (!familyIndex) {
+                            familyIndex = familyIndices.set(familyName, familyNames.size());
+                            familyNames.push_back(familyName);
+                            familyFonts.push_back();
+                        }
+                        familyFonts[*familyIndex].push_back(index);
+                    }
+                }
+            }
+        }
+
+        // Cannot hold FCLocker when matching.
+        auto familyOf = [&familyIndices](const sk_sp<SkTypeface>& typeface) {
+            if (!typeface) {
+                return -1;
+            }
+            SkString familyName;
+            typeface->getFamilyName(&familyName);
+            int* familyIndex = familyIndices.find(familyName);
+            return familyIndex ? *familyIndex : -1;
+        };
+
+        SkBinaryWriteBuffer buffer({});
+        buffer.writeUInt(kSnapshotMagic);
+        buffer.writeUInt(kSnapshotVersion);
+
+        buffer.writeUInt(watched.size());
+        for (const SkString& path : watched) {
+            buffer.writeString(path.c_str());
+            write_time(buffer, modified_time(path.c_str()));
+        }
+
+        buffer.writeUInt(fonts.size());
+        for (const Font& font : fonts) {
+            buffer.writeString(font.fPath.c_str());
+            buffer.writeInt(font.fIndex);
+            buffer.writeInt(font.fStyle.weight());
+            buffer.writeInt(font.fStyle.width());
+            buffer.writeInt(font.fStyle.slant());
+            buffer.writeBool(font.fIsFixedPitch);
+            buffer.writeString(font.fFamilyName.c_str());
+        }
+
+        buffer.writeUInt(familyNames.size());
+        for (int i = 0; i < familyNames.size(); ++i) {
+            buffer.writeString(familyNames[i].c_str());
+            buffer.writeUInt(familyFonts[i].size());
+            for (int fontIndex : familyFonts[i]) {
+                buffer.writeInt(fontIndex);
+            }
+        }
+
+        TArray<std::pair<const char*, int>> aliases;
+        for (const char* genericName : kSnapshotGenericNames) {
+            int familyIndex = familyOf(this->matchFamilyStyle(genericName, SkFontStyle()));
+            if (familyIndex >= 0 && !familyNames[familyIndex].equals(genericName)) {
+                aliases.push_back({genericName, familyIndex});
+            }
+        }
+        buffer.writeUInt(aliases.size());
+        for (const auto& [genericName, familyIndex] : aliases) {
+            buffer.writeString(genericName);
+            buffer.writeInt(familyIndex);
+        }
+
+        buffer.writeInt(familyOf(this->legacyMakeTypeface(nullptr, SkFontStyle())));
+
+        return buffer.writeToStream(stream);
+    }
+
 protected:
     int onCountFamilies() const override {
         return fFamilyNames->count();
@@ -991,6 +1186,220 @@ protected:
     }
 };
 
+/** A font manager answering from a snapshot written by SkFontMgr_fontconfig::writeSnapshot.
+ *  The fonts are opened with FreeType when first used, as with SkFontMgr_Custom.
+ */
+class SkFontMgr_fontconfig_snapshot : public SkFontMgr {
+public:
+    static sk_sp<SkFontMgr> Make(const char path[]) {
+        sk_sp<SkData> data = SkData::MakeFromFileName(path);
+        if (!data) {
+            return nullptr;
+        }
+        SkReadBuffer buffer(data->data(), data->size());
+        if (buffer.readUInt() != kSnapshotMagic || buffer.readUInt() != kSnapshotVersion) {
+            return nullptr;
+        }
+
+        auto readCount = [&buffer]() {
+            uint32_t count = buffer.readUInt();
+            // Every entry takes at least four bytes.
+            return buffer.validate(count <= buffer.available() / 4) ? (int)count : 0;
+        };
+
+        SkString string;
+        for (int i = readCount(); i --> 0 && buffer.isValid();) {
+            buffer.readString(&string);
+            if (read_time(buffer) != modified_time(string.c_str())) {
+                return nullptr;
+            }
+        }
+
+        TArray<sk_sp<SkTypeface>> fonts;
+        for (int i = readCount(); i --> 0 && buffer.isValid();) {
+            SkString fontPath;
+            buffer.readString(&fontPath);
+            int index = buffer.readInt();
+            int weight = buffer.readInt();
+            int width = buffer.readInt();
+            int slant = buffer.readInt();
+            bool isFixedPitch = buffer.readBool();
+            buffer.readString(&string);
+            if (!buffer.validate(SkFontStyle::kUpright_Slant <= slant &&
+                                 slant <= SkFontStyle::kOblique_Slant)) {
+                break;
+            }
+            SkFontStyle style(weight, width, static_cast<SkFontStyle::Slant>(slant));
+            fonts.push_back(sk_make_sp<SkTypeface_File>(style, isFixedPitch, true, string,
+                                                        fontPath.c_str(), index));
+        }
+
+        SkFontMgr_Custom::Families families;
+        TArray<SkString> familyNames;
+        for (int i = readCount(); i --> 0 && buffer.isValid();) {
+            buffer.readString(&string);
+            auto family = sk_make_sp<SkFontStyleSet_Custom>(string);
+            for (int j = readCount(); j --> 0 && buffer.isValid();) {
+                int fontIndex = buffer.readInt();
+                if (buffer.validate(0 <= fontIndex && fontIndex < fonts.size())) {
+                    family->appendTypeface(fonts[fontIndex]);
+                }
+            }
+            families.push_back(std::move(family));
+            familyNames.push_back(string);
+        }
+
+        TArray<std::pair<SkString, int>> aliases;
+        for (int i = readCount(); i --> 0 && buffer.isValid();) {
+            buffer.readString(&string);
+            int familyIndex = buffer.readInt();
+            if (buffer.validate(0 <= familyIndex && familyIndex < families.size())) {
+                aliases.push_back({string, familyIndex});
+            }
+        }
+
+        int defaultFamily = buffer.readInt();
+        if (!buffer.validate(-1 <= defaultFamily && defaultFamily < families.size()) ||
+            !buffer.validate(buffer.available() == 0)) {
+            return nullptr;
+        }
+        return sk_sp<SkFontMgr>(new SkFontMgr_fontconfig_snapshot(
+                std::move(families), std::move(familyNames), std::move(aliases), defaultFamily));
+    }
+
+protected:
+    int onCountFamilies() const override {
+        return fFamilies.size();
+    }
+
+    void onGetFamilyName(int index, SkString* familyName) const override {
+        SkASSERT(index < fFamilies.size());
+        *familyName = fFamilyNames[index];
+    }
+
+    sk_sp<SkFontStyleSet> onCreateStyleSet(int index) const override {
+        SkASSERT(index < fFamilies.size());
+        return fFamilies[index];
+    }
+
+    sk_sp<SkFontStyleSet> onMatchFamily(const char familyName[]) const override {
+        int familyIndex = this->findFamily(familyName);
+        return familyIndex >= 0 ? fFamilies[familyIndex] : nullptr;
+    }
+
+    sk_sp<SkTypeface> onMatchFamilyStyle(const char familyName[],
+                                         const SkFontStyle& style) const override {
+        int familyIndex = familyName ? this->findFamily(familyName) : fDefaultFamily;
+        return familyIndex >= 0 ? fFamilies[familyIndex]->matchStyle(style) : nullptr;
+    }
+
+    sk_sp<SkTypeface> onMatchFamilyStyleCharacter(const char familyName[],
+                                                  const SkFontStyle& style,
+                                                  const char* bcp47[],
+                                                  int bcp47Count,
+                                                  SkUnichar character) const override {
+        // The snapshot has no character sets, so only try the requested and default families.
+        for (int familyIndex : { familyName ? this->findFamily(familyName) : -1, fDefaultFamily }) {
+            if (familyIndex < 0) {
+                continue;
+            }
+            sk_sp<SkTypeface> typeface = fFamilies[familyIndex]->matchStyle(style);
+            if (typeface && typeface->unicharToGlyph(character) != 0) {
+                return typeface;
+            }
+        }
+        return nullptr;
+    }
+
+    sk_sp<SkTypeface> onMakeFromStreamIndex(std::unique_ptr<SkStreamAsset> stream,
+                                            int ttcIndex) const override {
+        return this->makeFromStream(std::move(stream),
+                                    SkFontArguments().setCollectionIndex(ttcIndex));
+    }
+
+    sk_sp<SkTypeface> onMakeFromStreamArgs(std::unique_ptr<SkStreamAsset> stream,
+                                           const SkFontArguments& args) const override {
+        return SkTypeface_FreeType::MakeFromStream(std::move(stream), args);
+    }
+
+    sk_sp<SkTypeface> onMakeFromData(sk_sp<SkData> data, int ttcIndex) const override {
+        return this->makeFromStream(std::make_unique<SkMemoryStream>(std::move(data)), ttcIndex);
+    }
+
+    sk_sp<SkTypeface> onMakeFromFile(const char path[], int ttcIndex) const override {
+        std::unique_ptr<SkStreamAsset> stream = SkStream::MakeFromFile(path);
+        return stream ? this->makeFromStream(std::move(stream), ttcIndex) : nullptr;
+    }
+
+    sk_sp<SkTypeface> onLegacyMakeTypeface(const char familyName[],
+                                           SkFontStyle style) const override {
+        sk_sp<SkTypeface> typeface;
+        if (familyName) {
+            typeface = this->onMatchFamilyStyle(familyName, style);
+        }
+        if (!typeface) {
+            typeface = this->onMatchFamilyStyle(nullptr, style);
+        }
+        return typeface;
+    }
+
+private:
+    SkFontMgr_fontconfig_snapshot(SkFontMgr_Custom::Families families,
+                                  TArray<SkString> familyNames,
+                                  TArray<std::pair<SkString, int>> aliases,
+                                  int defaultFamily)
+        : fFamilies(std::move(families))
+        , fFamilyNames(std::move(familyNames))
+        , fAliases(std::move(aliases))
+        , fDefaultFamily(defaultFamily) {}
+
+    /** FontConfig compares family names ignoring case. */
+    int findFamily(const char familyName[]) const {
+        if (!familyName) {
+            return -1;
+        }
+        for (int i = 0; i < fFamilyNames.size(); ++i) {
+            if (!strcasecmp(fFamilyNames[i].c_str(), familyName)) {
+                return i;
+            }
+        }
+        for (const auto& [alias, familyIndex] : fAliases) {
+            if (!strcasecmp(alias.c_str(), familyName)) {
+                return familyIndex;
+            }
+        }
+        return -1;
+    }
+
+    const SkFontMgr_Custom::Families fFamilies;
+    const TArray<SkString> fFamilyNames;
+    const TArray<std::pair<SkString, int>> fAliases;
+    const int fDefaultFamily;
+};
+
 sk_sp<SkFontMgr> SkFontMgr_New_FontConfig(FcConfig* fc, std::unique_ptr<SkFontScanner> scanner) {
     return sk_make_sp<SkFontMgr_fontconfig>(fc, std::move(scanner));
 }
+
+bool SkFontMgr_FontConfig_WriteSnapshot(FcConfig* fc,
+                                        std::unique_ptr<SkFontScanner> scanner,
+                                        const char path[]) {
+    auto fontMgr = sk_make_sp<SkFontMgr_fontconfig>(fc, std::move(scanner));
+
+    // Write to a temporary file so that readers never see a partial snapshot.
+    SkString tempPath = SkStringPrintf("%s.%d.tmp", path, (int)getpid());
+    bool written;
+    {
+        SkFILEWStream stream(tempPath.c_str());
+        written = stream.isValid() && fontMgr->writeSnapshot(&stream);
+    }
+    if (!written || rename(tempPath.c_str(), path) != 0) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+sk_sp<SkFontMgr> SkFontMgr_New_FontConfigSnapshot(const char path[]) {
+    return SkFontMgr_fontconfig_snapshot::Make(path);
+}
@@ -10,16 +10,22 @@
 #include "include/core/SkCanvas.h"
 #include "include/core/SkData.h"
 #include "include/core/SkDocument.h"
+#include "include/core/SkExecutor.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkImageInfo.h"
 #include "include/core/SkPicture.h"
 #include "include/core/SkPictureRecorder.h"
 #include "include/core/SkRect.h"
 #include "include/core/SkScalar.h"
 #include "include/core/SkSerialProcs.h"
 #include "include/core/SkStream.h"
+#include "include/core/SkSurface.h"
 #include "include/private/base/SkDebug.h"
 #include "include/private/base/SkTArray.h"
 #include "include/private/base/SkTo.h"
 #include "include/utils/SkNWayCanvas.h"
+#include "src/core/SkStreamPriv.h"
+#include "src/core/SkTaskGroup.h"
 #include "src/utils/SkMultiPictureDocumentPriv.h"
 
 #include <algorithm>
@@ -42,6 +48,21 @@ using namespace skia_private;
           float sizeY
         } * page_count
         skp file
+
+  Indexed file format (MakeIndexed):
+      BEGINNING_OF_FILE:
+        kMagic
+        uint32_t version_number (==3)
+        uint32_t page_count
+        {
+          float sizeX
+          float sizeY
+        } * page_count
+        {
+          uint64_t offset (from BEGINNING_OF_FILE)
+          uint64_t length
+        } * page_count
+        skp file * page_count
 */
 
 namespace {
@@ -51,6 +72,19 @@ static constexpr char kMagic[] = "Skia Multi-Picture Doc\n\n";
 static constexpr char kEndPage[] = "SkMultiPictureEndPage";
 
 const uint32_t kVersion = 2;
+const uint32_t kIndexedVersion = 3;
+
+struct PageEntry {
+    uint64_t fOffset;
+    uint64_t fLength;
+};
+
+constexpr size_t kHeaderSize = sizeof(kMagic) - 1 + 2 * sizeof(uint32_t);
+
+// The size of the header, page sizes and page table of an indexed document.
+constexpr size_t indexed_header_size(uint32_t pageCount) {
+    return kHeaderSize + pageCount * (sizeof(SkSize) + sizeof(PageEntry));
+}
 
 static SkSize join(const TArray<SkSize>& sizes) {
     SkSize joined = {0, 0};
@@ -115,6 +149,83 @@ struct MultiPictureDocument final : public SkDocument {
     }
 };
 
+struct IndexedMultiPictureDocument final : public SkDocument {
+    const SkSerialProcs fProcs;
+    SkPictureRecorder fPictureRecorder;
+    SkSize fCurrentPageSize;
+    TArray<sk_sp<SkData>> fPages;
+    TArray<SkSize> fSizes;
+    std::function<void(const SkPicture*)> fOnEndPage;
+    IndexedMultiPictureDocument(SkWStream* s,
+                                const SkSerialProcs* procs,
+                                std::function<void(const SkPicture*)> onEndPage)
+            : SkDocument(s)
+            , fProcs(procs ? *procs : SkSerialProcs())
+            , fOnEndPage(std::move(onEndPage)) {}
+
+    ~IndexedMultiPictureDocument() override { this->close(); }
+
+    SkCanvas* onBeginPage(SkScalar w, SkScalar h) override {
+        fCurrentPageSize.set(w, h);
+        return fPictureRecorder.beginRecording(w, h);
+    }
+    void onEndPage() override {
+        fSizes.push_back(fCurrentPageSize);
+        sk_sp<SkPicture> lastPage = fPictureRecorder.finishRecordingAsPicture();
+        if (fOnEndPage) {
+            fOnEndPage(lastPage.get());
+        }
+        sk_sp<SkData> data = lastPage->serialize(&fProcs);
+        fPages.push_back(data ? std::move(data) : SkData::MakeEmpty());
+    }
+    void onClose(SkWStream* wStream) override {
+        SkASSERT(wStream);
+        SkASSERT(wStream->bytesWritten() == 0);
+        wStream->writeText(kMagic);
+        wStream->write32(kIndexedVersion);
+        wStream->write32(SkToU32(fPages.size()));
+        for (SkSize s : fSizes) {
+            wStream->write(&s, sizeof(s));
+        }
+        uint64_t offset = indexed_header_size(SkToU32(fPages.size()));
+        for (const sk_sp<SkData>& page : fPages) {
+            PageEntry entry = {offset, page->size()};
+            wStream->write(&entry, sizeof(entry));
+            offset += page->size();
+        }
+        for (const sk_sp<SkData>& page : fPages) {
+            wStream->write(page->data(), page->size());
+        }
+        fPages.clear();
+        fSizes.clear();
+    }
+    void onAbort() override {
+        fPages.clear();
+        fSizes.clear();
+    }
+};
+
+// Reads the header of either format, leaving the stream at the page sizes.
+int read_header(SkStreamSeekable* src, uint32_t* version) {
+    if (!src) {
+        return 0;
+    }
+    src->seek(0);
+    const size_t size = sizeof(kMagic) - 1;
+    char buffer[size];
+    if (size != src->read(buffer, size) || 0 != memcmp(kMagic, buffer, size)) {
+        return 0;
+    }
+    if (!src->readU32(version) || (*version != kVersion && *version != kIndexedVersion)) {
+        return 0;
+    }
+    uint32_t pageCount;
+    if (!src->readU32(&pageCount) || pageCount > INT_MAX) {
+        return 0;
+    }
+    return SkTo<int>(pageCount);
+}
+
 struct PagerCanvas : public SkNWayCanvas {
     SkPictureRecorder fRecorder;
     SkDocumentPage* fDst;
@@ -153,27 +264,16 @@ sk_sp<SkDocument> Make(SkWStream* dst,
     return sk_make_sp<MultiPictureDocument>(dst, procs, std::move(onEndPage));
 }
 
+sk_sp<SkDocument> MakeIndexed(SkWStream* dst,
+                              const SkSerialProcs* procs,
+                              std::function<void(const SkPicture*)> onEndPage) {
+    return sk_make_sp<IndexedMultiPictureDocument>(dst, procs, std::move(onEndPage));
+}
+
 int ReadPageCount(SkStreamSeekable* src) {
-    if (!src) {
-        return 0;
-    }
-    src->seek(0);
-    const size_t size = sizeof(kMagic) - 1;
-    char buffer[size];
-    if (size != src->read(buffer, size) || 0 != memcmp(kMagic, buffer, size)) {
-        src = nullptr;
-        return 0;
-    }
     uint32_t versionNumber;
-    if (!src->readU32(&versionNumber) || versionNumber != kVersion) {
-        return 0;
-    }
-    uint32_t pageCount;
-    if (!src->readU32(&pageCount) || pageCount > INT_MAX) {
-        return 0;
-    }
     // leave stream position right here.
-    return SkTo<int>(pageCount);
+    return read_header(src, &versionNumber);
 }
 
 bool ReadPageSizes(SkStreamSeekable* stream,
@@ -200,9 +300,34 @@ bool Read(SkStreamSeekable* src,
           SkDocumentPage* dstArray,
           int dstArrayCount,
           const SkDeserialProcs* procs) {
-    if (!ReadPageSizes(src, dstArray, dstArrayCount)) {
+    uint32_t versionNumber;
+    if (read_header(src, &versionNumber) < 1 ||
+        !ReadPageSizes(src, dstArray, dstArrayCount)) {
         return false;
     }
+    if (versionNumber == kIndexedVersion) {
+        TArray<PageEntry> entries(dstArrayCount);
+        for (int i = 0; i < dstArrayCount; ++i) {
+            PageEntry& entry = entries.push_back();
+            if (sizeof(entry) != src->read(&entry, sizeof(entry))) {
+                return false;
+            }
+        }
+        for (int i = 0; i < dstArrayCount; ++i) {
+            // The table comes from the file, so check it before allocating the page's data.
+            if (entries[i].fOffset > SIZE_MAX || entries[i].fLength > SIZE_MAX ||
+                !src->seek(SkTo<size_t>(entries[i].fOffset)) ||
+                StreamRemainingLengthIsBelow(src, SkTo<size_t>(entries[i].fLength))) {
+                return false;
+            }
+            sk_sp<SkData> data = SkData::MakeFromStream(src, SkTo<size_t>(entries[i].fLength));
+            dstArray[i].fPicture = data ? SkPicture::MakeFromData(data.get(), procs) : nullptr;
+            if (!dstArray[i].fPicture) {
+                return false;
+            }
+        }
+        return true;
+    }
     SkSize joined = {0.0f, 0.0f};
     for (int i = 0; i < dstArrayCount; ++i) {
         joined = SkSize{std::max(joined.width(), dstArray[i].fSize.width()),
@@ -224,4 +349,73 @@ bool Read(SkStreamSeekable* src,
     }
     return true;
 }
+
+int ReadIndexedPageCount(const SkData* data) {
+    if (!data || data->size() < kHeaderSize) {
+        return 0;
+    }
+    const char* bytes = static_cast<const char*>(data->data());
+    const size_t size = sizeof(kMagic) - 1;
+    uint32_t versionNumber, pageCount;
+    memcpy(&versionNumber, bytes + size, sizeof(uint32_t));
+    memcpy(&pageCount, bytes + size + sizeof(uint32_t), sizeof(uint32_t));
+    const size_t maxPageCount =
+            (data->size() - kHeaderSize) / (sizeof(SkSize) + sizeof(PageEntry));
+    if (0 != memcmp(kMagic, bytes, size) || versionNumber != kIndexedVersion ||
+        pageCount > INT_MAX || pageCount > maxPageCount) {
+        return 0;
+    }
+    return SkTo<int>(pageCount);
+}
+
+SkDocumentPage ReadPage(const SkData* data, int pageIndex, const SkDeserialProcs* procs) {
+    SkDocumentPage page = {nullptr, {0, 0}};
+    const int pageCount = ReadIndexedPageCount(data);
+    if (pageIndex < 0 || pageIndex >= pageCount) {
+        return page;
+    }
+    const char* bytes = static_cast<const char*>(data->data());
+    PageEntry entry;
+    memcpy(&page.fSize, bytes + kHeaderSize + pageIndex * sizeof(SkSize), sizeof(SkSize));
+    memcpy(&entry,
+           bytes + kHeaderSize + pageCount * sizeof(SkSize) + pageIndex * sizeof(PageEntry),
+           sizeof(PageEntry));
+    if (entry.fOffset > data->size() || entry.fLength > data->size() - entry.fOffset) {
+        return page;
+    }
+    // A subset shares data, so that a page of a mapped document is read in place
+    sk_sp<SkData> pageData = SkData::MakeSubset(data, SkTo<size_t>(entry.fOffset),
+                                                  SkTo<size_t>(entry.fLength));
+    page.fPicture = SkPicture::MakeFromData(pageData.get(), procs);
+    return page;
+}
+
+std::vector<sk_sp<SkImage>> RasterizePages(const SkData* data,
+                                           SkSpan<const int> pageIndices,
+                                           float scale,
+                                           SkExecutor& executor,
+                                           const SkDeserialProcs* procs) {
+    std::vector<sk_sp<SkImage>> images(pageIndices.size());
+    SkTaskGroup pages(executor);
+    for (size_t i = 0; i < pageIndices.size(); ++i) {
+        pages.add([&, i] {
+            SkDocumentPage page = ReadPage(data, pageIndices[i], procs);
+            if (!page.fPicture) {
+                return;
+            }
+            SkISize size = SkISize::Make(SkScalarCeilToInt(page.fSize.width()  * scale),
+                                         SkScalarCeilToInt(page.fSize.height() * scale));
+            sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(size));
+            if (!surface) {
+                return;
+            }
+            SkCanvas* canvas = surface->getCanvas();
+            canvas->scale(scale, scale);
+            canvas->drawPicture(page.fPicture);
+            images[i] = surface->makeImageSnapshot();
+        });
+    }
+    pages.wait();
+    return images;
+}
 }  // namespace SkMultiPictureDocument
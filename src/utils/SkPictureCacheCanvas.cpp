@@ -0,0 +1,238 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/utils/SkPictureCacheCanvas.h"
+
+#include "include/core/SkColorSpace.h"
+#include "include/core/SkDrawable.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkImageInfo.h"
+#include "include/core/SkMatrix.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkScalar.h"
+#include "include/core/SkSurface.h"
+#include "include/core/SkSurfaceProps.h"
+#include "src/core/SkPicturePriv.h"
+#include "src/core/SkResourceCache.h"
+
+#include <cmath>
+#include <utility>
+
+namespace {
+static unsigned gPictureCacheKeyNamespaceLabel;
+
+struct PictureCacheKey : public SkResourceCache::Key {
+public:
+    // The first time content is drawn only a mark is added, with no image.
+    PictureCacheKey(uint64_t sharedID, bool mark, const SkMatrix& matrix,
+                    const SkImageInfo& info, const SkSurfaceProps& surfaceProps)
+        : fMark(mark)
+        , fColorSpaceXYZHash(info.colorSpace()->toXYZD50Hash())
+        , fColorSpaceTransferFnHash(info.colorSpace()->transferFnHash())
+        , fColorType(static_cast<uint32_t>(info.colorType()))
+        , fSurfaceProps(surfaceProps)
+    {
+        matrix.get9(fMatrix);
+        static const size_t keySize = sizeof(fMark) +
+                                      sizeof(fMatrix) +
+                                      sizeof(fColorSpaceXYZHash) +
+                                      sizeof(fColorSpaceTransferFnHash) +
+                                      sizeof(fColorType) +
+                                      sizeof(fSurfaceProps);
+        // This better be packed.
+        SkASSERT(sizeof(uint32_t) * (&fEndOfStruct - &fMark) == keySize);
+        this->init(&gPictureCacheKeyNamespaceLabel, sharedID, keySize);
+    }
+
+private:
+    uint32_t       fMark;
+    SkScalar       fMatrix[9];
+    uint32_t       fColorSpaceXYZHash;
+    uint32_t       fColorSpaceTransferFnHash;
+    uint32_t       fColorType;
+    SkSurfaceProps fSurfaceProps;
+
+    SkDEBUGCODE(uint32_t fEndOfStruct;)
+};
+
+struct PictureCacheRec : public SkResourceCache::Rec {
+    PictureCacheRec(const PictureCacheKey& key, sk_sp<SkImage> image)
+        : fKey(key)
+        , fImage(std::move(image)) {}
+
+    PictureCacheKey fKey;
+    sk_sp<SkImage>  fImage;
+
+    const Key& getKey() const override { return fKey; }
+    size_t bytesUsed() const override {
+        return sizeof(fKey) + (fImage ? fImage->imageInfo().computeMinByteSize() : 0);
+    }
+    const char* getCategory() const override { return "picture-cache"; }
+    SkDiscardableMemory* diagnostic_only_getDiscardable() const override { return nullptr; }
+
+    static bool Visitor(const SkResourceCache::Rec& baseRec, void* context) {
+        const PictureCacheRec& rec = static_cast<const PictureCacheRec&>(baseRec);
+        sk_sp<SkImage>* result = reinterpret_cast<sk_sp<SkImage>*>(context);
+
+        *result = rec.fImage;
+        return true;
+    }
+};
+
+uint64_t drawable_shared_id(SkDrawable* drawable) {
+    uint64_t sharedID = SkSetFourByteTag('d', 'r', 'b', 'l');
+    return (sharedID << 32) | drawable->getGenerationID();
+}
+}  // namespace
+
+SkPictureCacheCanvas::Cache::Cache(size_t byteBudget)
+        : fCache(std::make_unique<SkResourceCache>(byteBudget)) {}
+
+SkPictureCacheCanvas::Cache::~Cache() = default;
+
+sk_sp<SkPictureCacheCanvas::Cache> SkPictureCacheCanvas::Cache::Make(size_t byteBudget) {
+    return sk_sp<Cache>(new Cache(byteBudget));
+}
+
+size_t SkPictureCacheCanvas::Cache::bytesUsed() const {
+    SkAutoMutexExclusive lock(fMutex);
+    return fCache->getTotalBytesUsed();
+}
+
+size_t SkPictureCacheCanvas::Cache::byteBudget() const {
+    SkAutoMutexExclusive lock(fMutex);
+    return fCache->getTotalByteLimit();
+}
+
+void SkPictureCacheCanvas::Cache::purgeAll() {
+    SkAutoMutexExclusive lock(fMutex);
+    fCache->purgeAll();
+}
+
+SkPictureCacheCanvas::SkPictureCacheCanvas(SkCanvas* canvas, sk_sp<Cache> cache)
+        : SkNWayCanvas(canvas->imageInfo().width(), canvas->imageInfo().height())
+        , fTarget(canvas)
+        , fCache(std::move(cache)) {
+    SkASSERT(fCache);
+
+    // Transfer matrix & clip state before adding the target canvas.
+    this->clipRect(SkRect::Make(canvas->getDeviceClipBounds()));
+    this->setMatrix(canvas->getLocalToDevice());
+
+    this->addCanvas(canvas);
+}
+
+SkPictureCacheCanvas::~SkPictureCacheCanvas() = default;
+
+bool SkPictureCacheCanvas::drawCached(uint64_t sharedID,
+                                      const SkRect& bounds,
+                                      const SkMatrix* matrix,
+                                      const SkPaint* paint,
+                                      const std::function<void(SkCanvas*)>& draw) {
+    SkMatrix ctm = this->getLocalToDeviceAs3x3();
+    if (matrix) {
+        ctm.preConcat(*matrix);
+    }
+    if (bounds.isEmpty() || ctm.hasPerspective()) {
+        return false;
+    }
+
+    // Content is rasterized at the fraction of a pixel of its translation, so the same image
+    // can be drawn at any whole number of pixels from there.
+    const SkScalar dx = std::floor(ctm.getTranslateX());
+    const SkScalar dy = std::floor(ctm.getTranslateY());
+    if (!SkIsFinite(dx, dy)) {
+        return false;
+    }
+    ctm.postTranslate(-dx, -dy);
+    const SkIRect devBounds = ctm.mapRect(bounds).roundOut();
+    if (devBounds.isEmpty() ||
+        devBounds.width() > kMaxTileSize || devBounds.height() > kMaxTileSize) {
+        return false;
+    }
+
+    SkImageInfo info = fTarget->imageInfo();
+    SkColorType colorType = info.colorType() == kUnknown_SkColorType ? kN32_SkColorType
+                                                                      : info.colorType();
+    sk_sp<SkColorSpace> colorSpace = info.refColorSpace() ? info.refColorSpace()
+                                                          : SkColorSpace::MakeSRGB();
+    info = SkImageInfo::Make(devBounds.size(), colorType, kPremul_SkAlphaType, colorSpace);
+    const SkSurfaceProps props = fTarget->getBaseProps();
+
+    // Leave room for a few images, or one would evict all the others.
+    if (info.computeMinByteSize() > fCache->byteBudget() / 4) {
+        return false;
+    }
+
+    sk_sp<SkImage> image;
+    PictureCacheKey key(sharedID, false, ctm, info, props);
+    {
+        SkAutoMutexExclusive lock(fCache->fMutex);
+        if (!fCache->fCache->find(key, PictureCacheRec::Visitor, &image)) {
+            PictureCacheKey mark(sharedID, true, ctm, info, props);
+            sk_sp<SkImage> unused;
+            if (!fCache->fCache->find(mark, PictureCacheRec::Visitor, &unused)) {
+                fCache->fCache->add(new PictureCacheRec(mark, nullptr));
+                return false;
+            }
+        }
+    }
+
+    if (!image) {
+        sk_sp<SkSurface> surface = SkSurfaces::Raster(info, &props);
+        if (!surface) {
+            return false;
+        }
+        SkCanvas* canvas = surface->getCanvas();
+        canvas->translate(-devBounds.fLeft, -devBounds.fTop);
+        canvas->concat(ctm);
+        draw(canvas);
+        image = surface->makeImageSnapshot();
+        if (!image) {
+            return false;
+        }
+
+        SkAutoMutexExclusive lock(fCache->fMutex);
+        fCache->fCache->add(new PictureCacheRec(key, image));
+    }
+
+    // Draw the image pixel aligned, through this canvas so its state follows the target's.
+    const int saveCount = this->save();
+    this->setMatrix(SkMatrix::Translate(dx + devBounds.fLeft, dy + devBounds.fTop));
+    if (paint) {
+        const SkRect layerBounds = SkRect::Make(devBounds.size());
+        this->saveLayer(&layerBounds, paint);
+    }
+    this->drawImage(image.get(), 0, 0);
+    this->restoreToCount(saveCount);
+    return true;
+}
+
+void SkPictureCacheCanvas::onDrawPicture(const SkPicture* picture,
+                                         const SkMatrix* matrix,
+                                         const SkPaint* paint) {
+    const SkRect cull = picture->cullRect();
+    if (this->quickReject(matrix ? matrix->mapRect(cull) : cull)) {
+        return;
+    }
+    // Purge the images of the picture from the cache when it is deleted.
+    SkPicturePriv::AddedToCache(picture);
+    if (!this->drawCached(SkPicturePriv::MakeSharedID(picture->uniqueID()), cull, matrix, paint,
+                          [picture](SkCanvas* canvas) { canvas->drawPicture(picture); })) {
+        // Play it back through this canvas, so the pictures nested in it can be cached.
+        this->SkCanvas::onDrawPicture(picture, matrix, paint);
+    }
+}
+
+void SkPictureCacheCanvas::onDrawDrawable(SkDrawable* drawable, const SkMatrix* matrix) {
+    if (!this->drawCached(drawable_shared_id(drawable), drawable->getBounds(), matrix, nullptr,
+                          [drawable](SkCanvas* canvas) { canvas->drawDrawable(drawable); })) {
+        this->SkCanvas::onDrawDrawable(drawable, matrix);
+    }
+}
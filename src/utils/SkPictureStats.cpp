@@ -0,0 +1,233 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/utils/SkPictureStats.h"
+
+#include "include/core/SkBBHFactory.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkRefCnt.h"
+#include "include/private/base/SkTemplates.h"
+#include "src/core/SkBigPicture.h"
+#include "src/core/SkPicturePriv.h"
+#include "src/core/SkRecord.h"
+#include "src/core/SkRecordDraw.h"
+#include "src/core/SkRecords.h"
+#include "src/core/SkTHash.h"
+#include "src/utils/SkJSONWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <queue>
+#include <type_traits>
+
+using namespace SkRecords;
+
+namespace {
+const char* const kOpNames[] = {
+#define NAME(T) #T,
+    SK_RECORD_TYPES(NAME)
+#undef NAME
+};
+constexpr int kOpTypeCount = std::size(kOpNames);
+
+struct OpInfo {
+    Type fType;
+    int fTags;
+    const SkPaint* fPaint;
+    const SkPicture* fPicture;  // of a DrawPicture
+
+    template <typename T>
+    static OpInfo Make(const T& op) {
+        OpInfo info = {T::kType, T::kTags, nullptr, nullptr};
+        if constexpr ((T::kTags & kHasPaint_Tag) != 0) {
+            info.fPaint = AsPtr(op.paint);
+        }
+        if constexpr (std::is_same_v<T, DrawPicture>) {
+            info.fPicture = op.picture.get();
+        }
+        return info;
+    }
+
+    template <typename T>
+    OpInfo operator()(const T& op) { return Make(op); }
+
+private:
+    static const SkPaint* AsPtr(const Optional<SkPaint>& paint) { return paint; }
+    static const SkPaint* AsPtr(const SkPaint& paint) { return &paint; }
+};
+
+// How much more it costs to draw a pixel with this op than to fill it with a solid color.
+double complexity(const OpInfo& op) {
+    double weight = (op.fTags & kHasImage_Tag) ? 2 : 1;
+    if (const SkPaint* paint = op.fPaint) {
+        if (paint->getShader())      { weight += 1; }
+        if (paint->getColorFilter()) { weight += 0.5; }
+        if (paint->getPathEffect())  { weight += 1; }
+        if (!paint->isSrcOver())     { weight += 0.5; }
+        // Blurs and other filters read many pixels for each one they write.
+        if (paint->getMaskFilter())  { weight *= 2; }
+        if (paint->getImageFilter()) { weight *= 3; }
+    }
+    return weight;
+}
+
+double area(const SkRect& r) {
+    return r.isFinite() && !r.isEmpty() ? (double)r.width() * r.height() : 0;
+}
+
+// The cost of each nested picture already analyzed, by unique ID, so that a picture drawn many
+// times is only walked once.
+using NestedCosts = skia_private::THashMap<uint32_t, double>;
+
+SkPictureStats make_stats(const SkPicture* picture, int hottestOpCount, NestedCosts* nestedCosts) {
+    using Op = SkPictureStats::Op;
+    SkPictureStats stats;
+    if (!picture) {
+        return stats;
+    }
+    stats.fBytesUsed = picture->approximateBytesUsed();
+
+    const SkBigPicture* big = SkPicturePriv::AsSkBigPicture(sk_ref_sp(picture));
+    if (!big) {
+        stats.fOpCount = picture->approximateOpCount();
+        return stats;
+    }
+    const SkRecord& record = *big->record();
+    const SkRect cull = picture->cullRect();
+    stats.fOpCount = record.count();
+
+    skia_private::AutoTArray<SkRect> bounds(record.count());
+    skia_private::AutoTArray<SkBBoxHierarchy::Metadata> meta(record.count());
+    SkRecordFillBounds(cull, record, bounds.data(), meta.data());
+
+    int counts[kOpTypeCount] = {};
+    double costs[kOpTypeCount] = {};
+
+    // Whether each open save is a layer, and its size.
+    struct Save {
+        bool fLayer;
+        size_t fBytes;
+    };
+    std::vector<Save> saves;
+    int layerDepth = 0;
+    size_t layerBytes = 0;
+
+    auto cheaper = [](const Op& a, const Op& b) { return a.fCost > b.fCost; };
+    std::priority_queue<Op, std::vector<Op>, decltype(cheaper)> hottest(cheaper);
+
+    for (int i = 0; i < record.count(); i++) {
+        const OpInfo op = record.visit(i, OpInfo());
+        SkRect opBounds = bounds[i];
+        if (!opBounds.intersect(cull)) {
+            opBounds.setEmpty();
+        }
+
+        double cost = 0;
+        if (op.fType == SaveLayer_Type) {
+            // Clearing the layer, and drawing it when it is restored
+            cost = area(opBounds) * (1 + complexity(op));
+            const size_t bytes = static_cast<size_t>(area(opBounds)) * 4;
+            saves.push_back({true, bytes});
+            stats.fSaveLayerCount++;
+            layerDepth++;
+            layerBytes += bytes;
+            stats.fMaxSaveLayerDepth = std::max(stats.fMaxSaveLayerDepth, layerDepth);
+            stats.fPeakSaveLayerBytes = std::max(stats.fPeakSaveLayerBytes, layerBytes);
+        } else if (op.fType == Save_Type || op.fType == SaveBehind_Type) {
+            saves.push_back({false, 0});
+        } else if (op.fType == Restore_Type) {
+            if (!saves.empty()) {
+                if (saves.back().fLayer) {
+                    layerDepth--;
+                    layerBytes -= saves.back().fBytes;
+                }
+                saves.pop_back();
+            }
+        } else if (op.fPicture) {
+            const uint32_t id = op.fPicture->uniqueID();
+            if (const double* known = nestedCosts->find(id)) {
+                cost = *known;
+            } else {
+                cost = make_stats(op.fPicture, 0, nestedCosts).fCost;
+                nestedCosts->set(id, cost);
+            }
+        } else if (op.fTags & kDraw_Tag) {
+            cost = area(opBounds) * complexity(op);
+        }
+
+        counts[op.fType]++;
+        costs[op.fType] += cost;
+        stats.fCost += cost;
+
+        if (hottestOpCount > 0 && cost > 0) {
+            hottest.push({i, kOpNames[op.fType], opBounds, cost});
+            if (hottest.size() > static_cast<size_t>(hottestOpCount)) {
+                hottest.pop();
+            }
+        }
+    }
+
+    for (int type = 0; type < kOpTypeCount; type++) {
+        if (counts[type] > 0) {
+            stats.fOpTypes.push_back({kOpNames[type], counts[type], costs[type]});
+        }
+    }
+    while (!hottest.empty()) {
+        stats.fHottestOps.push_back(hottest.top());
+        hottest.pop();
+    }
+    std::reverse(stats.fHottestOps.begin(), stats.fHottestOps.end());
+    return stats;
+}
+}  // namespace
+
+SkPictureStats SkPictureStats::Make(const SkPicture* picture, int hottestOpCount) {
+    NestedCosts nestedCosts;
+    return make_stats(picture, hottestOpCount, &nestedCosts);
+}
+
+void SkPictureStats::dumpJSON(SkJSONWriter* writer) const {
+    writer->beginObject();
+    writer->appendS32("opCount", fOpCount);
+    writer->appendU64("bytesUsed", fBytesUsed);
+    writer->appendDouble("cost", fCost);
+
+    writer->beginObject("saveLayers");
+    writer->appendS32("count", fSaveLayerCount);
+    writer->appendS32("maxDepth", fMaxSaveLayerDepth);
+    writer->appendU64("peakBytes", fPeakSaveLayerBytes);
+    writer->endObject();
+
+    writer->beginArray("opTypes");
+    for (const OpType& type : fOpTypes) {
+        writer->beginObject(nullptr, false);
+        writer->appendCString("name", type.fName);
+        writer->appendS32("count", type.fCount);
+        writer->appendDouble("cost", type.fCost);
+        writer->endObject();
+    }
+    writer->endArray();
+
+    writer->beginArray("hottestOps");
+    for (const Op& op : fHottestOps) {
+        writer->beginObject(nullptr, false);
+        writer->appendS32("index", op.fIndex);
+        writer->appendCString("name", op.fName);
+        writer->beginArray("bounds", false);
+        writer->appendFloat(op.fBounds.fLeft);
+        writer->appendFloat(op.fBounds.fTop);
+        writer->appendFloat(op.fBounds.fRight);
+        writer->appendFloat(op.fBounds.fBottom);
+        writer->endArray();
+        writer->appendDouble("cost", op.fCost);
+        writer->endObject();
+    }
+    writer->endArray();
+
+    writer->endObject();
+}
@@ -0,0 +1,343 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/utils/SkPictureStream.h"
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkData.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkM44.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkRefCnt.h"
+#include "include/core/SkSerialProcs.h"
+#include "include/core/SkStream.h"
+#include "include/private/base/SkAlign.h"
+#include "include/private/base/SkTFitsIn.h"
+#include "include/private/base/SkTo.h"
+#include "src/core/SkBigPicture.h"
+#include "src/core/SkPicturePriv.h"
+#include "src/core/SkReadBuffer.h"
+#include "src/core/SkRecord.h"
+#include "src/core/SkRecordDraw.h"
+#include "src/core/SkRecords.h"
+#include "src/core/SkStreamPriv.h"
+#include "src/core/SkTHash.h"
+#include "src/core/SkWriteBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// The stream is a header followed by frames. Each frame is a tag, the size of its payload and
+// the payload, padded to 4 bytes.
+//
+//   kImage_Tag:  id, uses, the image as written by SkWriteBuffer::writeImage()
+//   kChunk_Tag:  a picture as written by SkPicture::serialize(), whose images are ids
+//   kEnd_Tag:    nothing
+namespace {
+constexpr char kMagic[] = { 's', 'k', 'p', 's', 't', 'r', 'e', 'm' };
+constexpr uint32_t kVersion = 1;
+
+enum Tag : uint32_t {
+    kEnd_Tag   = 0,
+    kImage_Tag = 1,
+    kChunk_Tag = 2,
+};
+
+// Classifies the ops that change the save stack and the clip.
+struct OpKind {
+    enum Kind { kOther, kSave, kLayer, kRestore, kClip, kResetClip };
+
+    template <typename T> Kind operator()(const T&) { return kOther; }
+    Kind operator()(const SkRecords::Save&)       { return kSave; }
+    Kind operator()(const SkRecords::SaveLayer&)  { return kLayer; }
+    Kind operator()(const SkRecords::SaveBehind&) { return kLayer; }
+    Kind operator()(const SkRecords::Restore&)    { return kRestore; }
+    Kind operator()(const SkRecords::ClipPath&)   { return kClip; }
+    Kind operator()(const SkRecords::ClipRRect&)  { return kClip; }
+    Kind operator()(const SkRecords::ClipRect&)   { return kClip; }
+    Kind operator()(const SkRecords::ClipRegion&) { return kClip; }
+    Kind operator()(const SkRecords::ClipShader&) { return kClip; }
+    Kind operator()(const SkRecords::ResetClip&)  { return kResetClip; }
+};
+
+// Calls chunk with pictures that draw picture when drawn one after the other, each starting
+// from the same canvas state.
+void split_into_chunks(const SkPicture* picture, int opsPerChunk,
+                       const std::function<void(sk_sp<SkPicture>)>& chunk) {
+    const SkBigPicture* big = SkPicturePriv::AsSkBigPicture(sk_ref_sp(picture));
+    if (!big) {
+        chunk(sk_ref_sp(picture));
+        return;
+    }
+    const SkRecord* record = big->record();
+
+    // The state a chunk must restore before its first op: each level of the save stack, with
+    // the matrix it was saved with and the clips made in it.
+    struct Level {
+        SkM44 fMatrix;
+        bool fSplittable;
+        std::vector<std::pair<SkM44, int>> fClips;  // the matrix and index of each clip op
+    };
+    std::vector<Level> levels = {{SkM44(), true, {}}};
+    SkM44 matrix;
+
+    int i = 0;
+    while (i < record->count()) {
+        SkPictureRecorder recorder;
+        SkCanvas* canvas = recorder.beginRecording(picture->cullRect());
+        SkRecords::Draw draw(canvas, big->drawablePicts(), nullptr, big->drawableCount());
+        for (size_t l = 0; l < levels.size(); ++l) {
+            if (l > 0) {
+                canvas->setMatrix(levels[l].fMatrix);
+                canvas->save();
+            }
+            for (const auto& [clipMatrix, clip] : levels[l].fClips) {
+                canvas->setMatrix(clipMatrix);
+                record->visit(clip, draw);
+            }
+        }
+        canvas->setMatrix(matrix);
+
+        bool splittable = true;
+        for (int ops = 0; i < record->count() && (ops < opsPerChunk || !splittable); ++ops, ++i) {
+            const OpKind::Kind kind = record->visit(i, OpKind());
+            switch (kind) {
+                case OpKind::kSave:
+                case OpKind::kLayer:
+                    // A layer can't be split: its ops must be drawn before it is restored.
+                    levels.push_back({canvas->getLocalToDevice(), kind == OpKind::kSave, {}});
+                    break;
+                case OpKind::kRestore:
+                    if (levels.size() > 1) {
+                        levels.pop_back();
+                    }
+                    break;
+                case OpKind::kClip:
+                    levels.back().fClips.push_back({canvas->getLocalToDevice(), i});
+                    break;
+                case OpKind::kResetClip:
+                    // The clips before it can't be restored in order; keep its level whole.
+                    levels.back().fSplittable = false;
+                    break;
+                case OpKind::kOther:
+                    break;
+            }
+            record->visit(i, draw);
+
+            splittable = true;
+            for (const Level& level : levels) {
+                splittable &= level.fSplittable;
+            }
+        }
+        matrix = canvas->getLocalToDevice();
+        chunk(recorder.finishRecordingAsPicture());
+    }
+}
+
+bool write_frame(SkWStream* stream, Tag tag, const SkData* payload) {
+    const size_t size = payload ? payload->size() : 0;
+    if (!SkTFitsIn<uint32_t>(size)) {
+        return false;
+    }
+    if (!stream->write32(tag) || !stream->write32(SkToU32(size))) {
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+    static constexpr uint32_t kZero = 0;
+    return stream->write(payload->data(), size) &&
+           stream->write(&kZero, SkAlign4(size) - size);
+}
+
+// Serializes the images of chunks as ids, counting their uses in the first pass and collecting
+// the ones to write in the second.
+struct ImageWriter {
+    SkSerialProcs fProcs;
+    bool fCounting = true;
+    skia_private::THashMap<uint32_t, uint32_t> fUses;
+    skia_private::THashSet<uint32_t> fWritten;
+    std::vector<sk_sp<SkImage>> fPending;
+
+    static sk_sp<SkData> Proc(SkImage* image, void* ctx) {
+        ImageWriter* writer = static_cast<ImageWriter*>(ctx);
+        const uint32_t id = image->uniqueID();
+        if (writer->fCounting) {
+            writer->fUses[id] += 1;
+        } else if (!writer->fWritten.contains(id)) {
+            writer->fWritten.add(id);
+            writer->fPending.push_back(sk_ref_sp(image));
+        }
+        return SkData::MakeWithCopy(&id, sizeof(id));
+    }
+
+    bool writePending(SkWStream* stream) {
+        for (const sk_sp<SkImage>& image : fPending) {
+            const uint32_t id = image->uniqueID();
+            // Images made while serializing, like mipmap levels, are new in each pass.
+            const uint32_t* uses = fUses.find(id);
+            SkBinaryWriteBuffer buffer(fProcs);
+            buffer.write32(id);
+            buffer.write32(uses ? *uses : 1);
+            buffer.writeImage(image.get());
+            if (!write_frame(stream, kImage_Tag, buffer.snapshotAsData().get())) {
+                return false;
+            }
+        }
+        fPending.clear();
+        return true;
+    }
+};
+
+// Looks up the images of chunks by id, dropping them after their last use.
+struct ImageReader {
+    struct Entry {
+        sk_sp<SkImage> fImage;
+        uint32_t fUses;
+    };
+    skia_private::THashMap<uint32_t, Entry> fImages;
+
+    static sk_sp<SkImage> Proc(sk_sp<SkData> data, std::optional<SkAlphaType>, void* ctx) {
+        ImageReader* reader = static_cast<ImageReader*>(ctx);
+        uint32_t id;
+        if (data->size() != sizeof(id)) {
+            return nullptr;
+        }
+        memcpy(&id, data->data(), sizeof(id));
+        Entry* entry = reader->fImages.find(id);
+        if (!entry) {
+            return nullptr;
+        }
+        sk_sp<SkImage> image = entry->fImage;
+        if (--entry->fUses == 0) {
+            reader->fImages.remove(id);
+        }
+        return image;
+    }
+};
+}  // namespace
+
+bool SkPictureStream::Write(const SkPicture* picture, SkWStream* stream,
+                            const SkSerialProcs* procs, int opsPerChunk) {
+    if (!picture || !stream) {
+        return false;
+    }
+    opsPerChunk = std::max(opsPerChunk, 1);
+
+    const SkRect cull = picture->cullRect();
+    if (!stream->write(kMagic, sizeof(kMagic)) || !stream->write32(kVersion) ||
+        !stream->write(&cull, sizeof(cull))) {
+        return false;
+    }
+
+    ImageWriter images;
+    if (procs) {
+        images.fProcs = *procs;
+    }
+    SkSerialProcs chunkProcs = images.fProcs;
+    chunkProcs.fImageProc = ImageWriter::Proc;
+    chunkProcs.fImageCtx = &images;
+
+    // First count how many times each image is written, then write the chunks, each after the
+    // images it uses for the first time. The chunks are made again rather than kept.
+    split_into_chunks(picture, opsPerChunk, [&](sk_sp<SkPicture> chunk) {
+        SkNullWStream counter;
+        chunk->serialize(&counter, &chunkProcs);
+    });
+    images.fCounting = false;
+
+    bool ok = true;
+    split_into_chunks(picture, opsPerChunk, [&](sk_sp<SkPicture> chunk) {
+        if (!ok) {
+            return;
+        }
+        sk_sp<SkData> data = chunk->serialize(&chunkProcs);
+        ok = data && images.writePending(stream) && write_frame(stream, kChunk_Tag, data.get());
+    });
+    return ok && write_frame(stream, kEnd_Tag, nullptr);
+}
+
+bool SkPictureStream::ReadHeader(SkStream* stream, SkRect* cullRect) {
+    char magic[sizeof(kMagic)];
+    uint32_t version;
+    SkRect cull;
+    if (!stream || stream->read(magic, sizeof(magic)) != sizeof(magic) ||
+        memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+        !stream->readU32(&version) || version != kVersion ||
+        stream->read(&cull, sizeof(cull)) != sizeof(cull)) {
+        return false;
+    }
+    if (cullRect) {
+        *cullRect = cull;
+    }
+    return true;
+}
+
+bool SkPictureStream::Play(SkStream* stream, SkCanvas* canvas, const SkDeserialProcs* procs) {
+    if (!stream || !canvas) {
+        return false;
+    }
+    ImageReader images;
+    SkDeserialProcs userProcs;
+    if (procs) {
+        userProcs = *procs;
+    }
+    SkDeserialProcs chunkProcs = userProcs;
+    chunkProcs.fImageDataProc = ImageReader::Proc;
+    chunkProcs.fImageCtx = &images;
+
+    while (true) {
+        uint32_t tag, size;
+        if (!stream->readU32(&tag) || !stream->readU32(&size)) {
+            return false;
+        }
+        if (tag == kEnd_Tag) {
+            return size == 0;
+        }
+        if (StreamRemainingLengthIsBelow(stream, size)) {
+            return false;
+        }
+        sk_sp<SkData> payload = SkData::MakeUninitialized(size);
+        const size_t padding = SkAlign4(size) - size;
+        if (stream->read(payload->writable_data(), size) != size ||
+            stream->skip(padding) != padding) {
+            return false;
+        }
+
+        switch (tag) {
+            case kImage_Tag: {
+                SkReadBuffer buffer(payload->data(), payload->size());
+                buffer.setDeserialProcs(userProcs);
+                const uint32_t id = buffer.read32();
+                const uint32_t uses = buffer.read32();
+                sk_sp<SkImage> image = buffer.readImage();
+                if (!buffer.isValid() || uses == 0) {
+                    return false;
+                }
+                images.fImages.set(id, {std::move(image), uses});
+                break;
+            }
+            case kChunk_Tag: {
+                sk_sp<SkPicture> chunk = SkPicture::MakeFromData(payload.get(), &chunkProcs);
+                if (!chunk) {
+                    return false;
+                }
+                // Every chunk starts from the state the canvas had before the first one.
+                SkAutoCanvasRestore acr(canvas, true);
+                chunk->playback(canvas);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+}